@@ -23,6 +23,7 @@
 
 #include <core/application.h>
 #include <core/applicationsingleton.h>
+#include <registry/docsetregistry.h>
 #include <registry/searchquery.h>
 
 #include <QApplication>
@@ -50,6 +51,7 @@ struct CommandLineParameters
 {
     bool force;
     bool preventActivation;
+    QString loadTimelineFile;
     Registry::SearchQuery query;
 #ifdef Q_OS_WIN32
     bool registerProtocolHandlers;
@@ -76,6 +78,9 @@ CommandLineParameters parseCommandLine(const QStringList &arguments)
 
     parser.addOption({{QStringLiteral("f"), QStringLiteral("force")},
                       QObject::tr("Force the application run.")});
+    parser.addOption({QStringLiteral("load-timeline"),
+                      QObject::tr("Save docset loading timeline in Chrome trace format on exit."),
+                      QObject::tr("file")});
 
 #ifdef Q_OS_WIN32
     parser.addOption(QCommandLineOption({QStringLiteral("register")},
@@ -89,6 +94,7 @@ CommandLineParameters parseCommandLine(const QStringList &arguments)
     CommandLineParameters clParams;
     clParams.force = parser.isSet(QStringLiteral("force"));
     clParams.preventActivation = false;
+    clParams.loadTimelineFile = parser.value(QStringLiteral("load-timeline"));
 
 #ifdef Q_OS_WIN32
     clParams.registerProtocolHandlers = parser.isSet(QStringLiteral("register"));
@@ -239,5 +245,10 @@ int main(int argc, char *argv[])
         });
     }
 
-    return qapp->exec();
+    const int exitCode = qapp->exec();
+
+    if (!clParams.loadTimelineFile.isEmpty())
+        app->docsetRegistry()->saveLoadTimeline(clParams.loadTimelineFile);
+
+    return exitCode;
 }
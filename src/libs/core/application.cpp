@@ -74,6 +74,8 @@ Application::Application(QObject *parent) :
     connect(m_extractor, &Extractor::progress, this, &Application::extractionProgress);
 
     m_docsetRegistry = new Registry::DocsetRegistry();
+    m_docsetRegistry->setRecentDocsets(m_settings->recentDocsets);
+    m_docsetRegistry->setCachePath(cacheLocation());
 
     connect(m_settings, &Settings::updated, this, &Application::applySettings);
     applySettings();
@@ -96,6 +98,8 @@ Application::~Application()
     m_extractorThread->wait();
     delete m_extractor;
     delete m_mainWindow;
+
+    m_settings->recentDocsets = m_docsetRegistry->recentDocsets();
     delete m_docsetRegistry;
 }
 
@@ -230,8 +234,13 @@ void Application::checkForUpdates(bool quiet)
 
 void Application::applySettings()
 {
+    m_docsetRegistry->setLoadConcurrency(m_settings->docsetLoadConcurrency);
     m_docsetRegistry->setStoragePath(m_settings->docsetPath);
     m_docsetRegistry->setFuzzySearchEnabled(m_settings->fuzzySearchEnabled);
+    m_docsetRegistry->setFuzzyMatchMode(m_settings->fuzzySearchBestMatchEnabled
+                                        ? Registry::FuzzyMatcher::Mode::BestMatch
+                                        : Registry::FuzzyMatcher::Mode::Compatible);
+    m_docsetRegistry->setDocsetPreloadEnabled(m_settings->docsetPreloadEnabled);
 
     // HTTP Proxy Settings
     switch (m_settings->proxyType) {
@@ -88,6 +88,9 @@ void Settings::load()
 
     settings->beginGroup(GroupSearch);
     fuzzySearchEnabled = settings->value(QStringLiteral("fuzzy_search_enabled"), false).toBool();
+    fuzzySearchBestMatchEnabled
+            = settings->value(QStringLiteral("fuzzy_search_best_match_enabled"), false).toBool();
+    docsetPreloadEnabled = settings->value(QStringLiteral("docset_preload_enabled"), false).toBool();
     settings->endGroup();
 
     settings->beginGroup(GroupContent);
@@ -161,6 +164,7 @@ void Settings::load()
         docsetPath = QStringLiteral("docsets");
 #endif
     }
+    docsetLoadConcurrency = settings->value(QStringLiteral("load_concurrency"), 2).toInt();
     settings->endGroup();
 
     // Create the docset storage directory if it doesn't exist.
@@ -178,6 +182,7 @@ void Settings::load()
     windowGeometry = settings->value(QStringLiteral("window_geometry")).toByteArray();
     verticalSplitterGeometry = settings->value(QStringLiteral("splitter_geometry")).toByteArray();
     tocSplitterState = settings->value(QStringLiteral("toc_splitter_state")).toByteArray();
+    recentDocsets = settings->value(QStringLiteral("recent_docsets")).toStringList();
     settings->endGroup();
 
     settings->beginGroup(GroupInternal);
@@ -209,6 +214,8 @@ void Settings::save()
 
     settings->beginGroup(GroupSearch);
     settings->setValue(QStringLiteral("fuzzy_search_enabled"), fuzzySearchEnabled);
+    settings->setValue(QStringLiteral("fuzzy_search_best_match_enabled"), fuzzySearchBestMatchEnabled);
+    settings->setValue(QStringLiteral("docset_preload_enabled"), docsetPreloadEnabled);
     settings->endGroup();
 
     settings->beginGroup(GroupContent);
@@ -239,12 +246,14 @@ void Settings::save()
 
     settings->beginGroup(GroupDocsets);
     settings->setValue(QStringLiteral("path"), docsetPath);
+    settings->setValue(QStringLiteral("load_concurrency"), docsetLoadConcurrency);
     settings->endGroup();
 
     settings->beginGroup(GroupState);
     settings->setValue(QStringLiteral("window_geometry"), windowGeometry);
     settings->setValue(QStringLiteral("splitter_geometry"), verticalSplitterGeometry);
     settings->setValue(QStringLiteral("toc_splitter_state"), tocSplitterState);
+    settings->setValue(QStringLiteral("recent_docsets"), recentDocsets);
     settings->endGroup();
 
     settings->beginGroup(GroupInternal);
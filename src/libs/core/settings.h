@@ -25,6 +25,7 @@
 
 #include <QObject>
 #include <QKeySequence>
+#include <QStringList>
 
 class QSettings;
 
@@ -59,6 +60,8 @@ public:
 
     // Search
     bool fuzzySearchEnabled;
+    bool fuzzySearchBestMatchEnabled;
+    bool docsetPreloadEnabled;
 
     // Content
     QString defaultFontFamily;
@@ -108,11 +111,13 @@ public:
 
     // Other
     QString docsetPath;
+    int docsetLoadConcurrency; // Number of docsets read from disk at once.
 
     // State
     QByteArray windowGeometry;
     QByteArray verticalSplitterGeometry;
     QByteArray tocSplitterState;
+    QStringList recentDocsets;
 
     explicit Settings(QObject *parent = nullptr);
     ~Settings() override;
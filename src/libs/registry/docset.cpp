@@ -24,27 +24,35 @@
 #include "docset.h"
 
 #include "cancellationtoken.h"
+#include "docsetsnapshot.h"
+#include "loadtimeline.h"
+#include "scorer.h"
+#include "searchquery.h"
 #include "searchresult.h"
+#include "symbolindex.h"
 
 #include <util/plist.h>
+#include <util/sqliteconnectionpool.h>
 #include <util/sqlitedatabase.h>
+#include <util/sqlitestatement.h>
 
 #include <QDir>
 #include <QFile>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QLoggingCategory>
 #include <QRegularExpression>
-#include <QVariant>
-#include <QVarLengthArray>
 
-#include <sqlite3.h>
-
-#include <cstring>
+#include <algorithm>
+#include <numeric>
 #include <utility>
 
 using namespace Zeal::Registry;
 
+static Q_LOGGING_CATEGORY(log, "zeal.registry.docset")
+
 namespace {
 const char IndexNamePrefix[] = "__zi_name"; // zi - Zeal index
 const char IndexNameVersion[] = "0001"; // Current index version
@@ -62,25 +70,58 @@ const char IsJavaScriptEnabled[] = "isJavaScriptEnabled";
 }
 }
 
-static void sqliteScoreFunction(sqlite3_context *context, int argc, sqlite3_value **argv);
+static int scoreSubstring(const char *haystack, int haystackLength,
+                          const char *needle, int needleLength);
 
-Docset::Docset(QString path) :
-    m_path(std::move(path))
+namespace {
+// Interrupts running statements of the database when the token is canceled.
+class InterruptGuard
+{
+public:
+    InterruptGuard(Zeal::Util::SQLiteDatabase *db, const CancellationToken &token)
+        : m_db(db)
+    {
+        m_db->setInterruptCallback([&token] { return token.isCanceled(); });
+    }
+
+    ~InterruptGuard()
+    {
+        m_db->setInterruptCallback(nullptr);
+    }
+
+private:
+    Zeal::Util::SQLiteDatabase *m_db;
+};
+} // namespace
+
+Docset::Docset(QString path, LoadTimeline *loadTimeline) :
+    m_path(std::move(path)),
+    m_loadTimeline(loadTimeline)
 {
     QDir dir(m_path);
     if (!dir.exists())
         return;
 
-    loadMetadata();
+    m_fileStamps = DocsetSnapshot::fileStamps(m_path);
 
-    // Attempt to find the icon in any supported format
-    const auto iconFiles = dir.entryList({QStringLiteral("icon.*")}, QDir::Files);
-    for (const QString &iconFile : iconFiles) {
-        m_icon = QIcon(dir.filePath(iconFile));
-        if (!m_icon.availableSizes().isEmpty())
-            break;
+    {
+        const LoadTimeline::Scope scope(m_loadTimeline, "Metadata", m_path);
+
+        loadMetadata();
+
+        // Attempt to find the icon in any supported format
+        const auto iconFiles = dir.entryList({QStringLiteral("icon.*")}, QDir::Files);
+        for (const QString &iconFile : iconFiles) {
+            m_icon = QIcon(dir.filePath(iconFile));
+            if (!m_icon.availableSizes().isEmpty()) {
+                m_iconPath = dir.filePath(iconFile);
+                break;
+            }
+        }
     }
 
+    const LoadTimeline::Scope scope(m_loadTimeline, "Info.plist", m_path);
+
     // TODO: Report errors here and below
     if (!dir.cd(QStringLiteral("Contents")))
         return;
@@ -121,32 +162,12 @@ Docset::Docset(QString path) :
         m_name = m_name + QLatin1String("cheats");
     }
 
+    // The database is opened on first use, see openDatabase().
     if (!dir.cd(QStringLiteral("Resources")) || !dir.exists(QStringLiteral("docSet.dsidx")))
         return;
 
-    m_db = new Util::SQLiteDatabase(dir.filePath(QStringLiteral("docSet.dsidx")));
-
-    if (!m_db->isOpen()) {
-        qWarning("SQL Error: %s", qPrintable(m_db->lastError()));
-        return;
-    }
-
-    sqlite3_create_function(m_db->handle(), "zealScore", 2, SQLITE_UTF8, nullptr,
-                            sqliteScoreFunction, nullptr, nullptr);
-
-    m_type = m_db->tables().contains(QStringLiteral("searchIndex"), Qt::CaseInsensitive)
-            ? Type::Dash : Type::ZDash;
-
-    createIndex();
-
-    if (m_type == Docset::Type::ZDash) {
-        createView();
-    }
-
-    if (!dir.cd(QStringLiteral("Documents"))) {
-        m_type = Type::Invalid;
+    if (!dir.cd(QStringLiteral("Documents")))
         return;
-    }
 
     // Setup keywords
     if (plist.contains(InfoPlist::DocSetPlatformFamily))
@@ -181,17 +202,57 @@ Docset::Docset(QString path) :
             qWarning("Cannot determine index file for docset %s", qPrintable(m_name));
     }
 
-    countSymbols();
+    m_isValid = true;
+}
+
+Docset::Docset(const DocsetSnapshot &snapshot, LoadTimeline *loadTimeline) :
+    m_name(snapshot.name),
+    m_title(snapshot.title),
+    m_keywords(snapshot.keywords),
+    m_version(snapshot.version),
+    m_revision(snapshot.revision),
+    m_feedUrl(snapshot.feedUrl),
+    m_path(snapshot.path),
+    m_iconPath(snapshot.iconPath),
+    m_fileStamps(snapshot.fileStamps),
+    m_loadTimeline(loadTimeline),
+    m_indexFileUrl(snapshot.indexFileUrl),
+    m_javaScriptEnabled(snapshot.javaScriptEnabled)
+{
+    const LoadTimeline::Scope scope(m_loadTimeline, "Snapshot", m_path);
+
+    if (!m_iconPath.isEmpty())
+        m_icon = QIcon(m_iconPath);
+
+    // The type is only known if the database has been opened before.
+    m_type = static_cast<Type>(snapshot.type);
+    if (m_type != Type::Invalid) {
+        m_symbolStrings = snapshot.symbolStrings;
+        m_symbolCounts = snapshot.symbolCounts;
+        m_hasSymbolCounts = true;
+    }
+
+    m_isValid = true;
 }
 
 Docset::~Docset()
 {
+    if (m_connectionPool != nullptr) {
+        const Util::SQLiteConnectionPool::Statistics statistics = m_connectionPool->statistics();
+        qCDebug(log, "Connection pool of '%s': %d/%d connections, %d waits out of %d,"
+                     " %lld us total wait time, %lld us max wait time.",
+                qPrintable(m_name), statistics.size, statistics.maxSize, statistics.waitCount,
+                statistics.acquireCount, statistics.totalWaitTime, statistics.maxWaitTime);
+    }
+
+    delete m_symbolIndex;
+    delete m_connectionPool;
     delete m_db;
 }
 
 bool Docset::isValid() const
 {
-    return m_type != Type::Invalid;
+    return m_isValid;
 }
 
 QString Docset::name() const
@@ -254,72 +315,286 @@ QUrl Docset::indexFileUrl() const
 
 QMap<QString, int> Docset::symbolCounts() const
 {
+    ensureSymbolCounts();
     return m_symbolCounts;
 }
 
 int Docset::symbolCount(const QString &symbolType) const
 {
+    ensureSymbolCounts();
     return m_symbolCounts.value(symbolType);
 }
 
 const QMap<QString, QUrl> &Docset::symbols(const QString &symbolType) const
 {
-    if (!m_symbols.contains(symbolType))
+    if (!m_symbols.contains(symbolType) && ensureDatabase())
         loadSymbols(symbolType);
     return m_symbols[symbolType];
 }
 
-QList<SearchResult> Docset::search(const QString &query, const CancellationToken &token) const
+QVector<SearchHit> Docset::search(const SearchQuery &query, const CancellationToken &token,
+                                  const QVector<SearchHit> *candidates) const
 {
-    QString sql;
-    if (m_type == Docset::Type::Dash) {
-        if (m_fuzzySearchEnabled) {
-            sql = QStringLiteral("SELECT name, type, path, '', zealScore('%1', name) as score"
-                                 "  FROM searchIndex"
-                                 "  WHERE score > 0");
+    static const int BlockSize = 256;
+    // Names with typos are only looked for when there are fewer hits.
+    static const int MinHitCount = 10;
+
+    QVector<SearchHit> hits;
+
+    if (!ensureSymbolIndex(token))
+        return hits;
+
+    const QByteArray needle = query.query().toUtf8();
+
+    const bool isTabulatedQuery = candidates == nullptr && isTabulated(query);
+    const QPair<int, QByteArray> tableKey(scoringMode(), needle);
+    if (isTabulatedQuery) {
+        QMutexLocker locker(&m_tabulatedHitsMutex);
+        const auto it = m_tabulatedHits.constFind(tableKey);
+        if (it != m_tabulatedHits.cend())
+            return it.value();
+
+        if (const QVector<SearchHit> *recentHits = m_recentTabulatedHits.object(tableKey))
+            return *recentHits;
+    }
+
+    // Whitespace separated terms must all match, in any order. Longer terms tend to be more
+    // selective, so they are checked first, and the rest only for names that have matched.
+    QList<QByteArray> terms = needle.simplified().split(' ');
+    std::stable_sort(terms.begin(), terms.end(), [](const QByteArray &a, const QByteArray &b) {
+        return a.size() > b.size();
+    });
+
+    QList<Scorer> scorers;
+    for (const QByteArray &term : qAsConst(terms))
+        scorers.append(Scorer(term, m_fuzzyMatchMode));
+
+    // Positions of symbols to score, unless all of them are scanned in order.
+    QVector<int> positions;
+    bool scanAll = false;
+
+    if (candidates != nullptr) {
+        positions.reserve(candidates->size());
+        for (const SearchHit &hit : *candidates)
+            positions.append(hit.index);
+    } else if (!m_fuzzySearchEnabled && terms.first().size() >= 3) {
+        // Substring search only checks names that contain all trigrams of the terms.
+        positions = m_symbolIndex->substringCandidates(terms);
+    } else {
+        scanAll = true;
+    }
+
+    // Symbols of other types are never scored.
+    const QVector<bool> allowedTypeIds = symbolTypeFilter(query.symbolTypes());
+    if (!allowedTypeIds.isEmpty()) {
+        auto isAllowed = [this, &allowedTypeIds](int index) {
+            return allowedTypeIds.at(m_symbolIndex->typeId(index));
+        };
+
+        if (scanAll) {
+            for (int i = 0; i < m_symbolIndex->count(); ++i) {
+                if (isAllowed(i))
+                    positions.append(i);
+            }
+
+            scanAll = false;
         } else {
-            sql = QStringLiteral("SELECT name, type, path, '', -length(name) as score"
-                                 "  FROM searchIndex"
-                                 "  WHERE (name LIKE '%%1%' ESCAPE '\\')");
+            positions.erase(std::remove_if(positions.begin(), positions.end(),
+                                           [&isAllowed](int index) { return !isAllowed(index); }),
+                            positions.end());
         }
-    } else {
-        if (m_fuzzySearchEnabled) {
-            sql = QStringLiteral("SELECT name, type, path, fragment, zealScore('%1', name) as score"
-                                 "  FROM searchIndex"
-                                 "  WHERE score > 0");
+    }
+
+    const int count = scanAll ? m_symbolIndex->count() : positions.size();
+
+    // Names missing any character of the terms cannot match them.
+    quint64 requiredSignature = 0;
+    for (const QByteArray &term : qAsConst(terms))
+        requiredSignature |= Scorer::signature(term.constData(), term.size());
+
+    // A single character rejects too few names to beat scoring them in batch.
+    const bool scoreInBatch = scanAll && m_fuzzySearchEnabled && qPopulationCount(requiredSignature) <= 1;
+
+    const quint64 *signatures = m_symbolIndex->signatures();
+
+    int indices[BlockSize];
+    quint64 gatheredSignatures[BlockSize];
+    int passed[BlockSize]; // Block offsets of names to score.
+    int scores[BlockSize];
+
+    for (int first = 0; first < count; first += BlockSize) {
+        if (token.isCanceled())
+            break;
+
+        const int blockCount = qMin(BlockSize, count - first);
+
+        for (int i = 0; i < blockCount; ++i)
+            indices[i] = scanAll ? first + i : positions.at(first + i);
+
+        int passedCount = blockCount;
+
+        if (scoreInBatch) {
+            scorers.first().score(m_symbolIndex->normalizedNames(),
+                                  m_symbolIndex->nameOffsets() + first, blockCount, scores);
+            std::iota(passed, passed + blockCount, 0);
         } else {
-            sql = QStringLiteral("SELECT name, type, path, fragment, -length(name) as score"
-                                 "  FROM searchIndex"
-                                 "  WHERE (name LIKE '%%1%' ESCAPE '\\')");
+            const quint64 *blockSignatures = signatures + first;
+            if (!scanAll) {
+                for (int i = 0; i < blockCount; ++i)
+                    gatheredSignatures[i] = signatures[indices[i]];
+                blockSignatures = gatheredSignatures;
+            }
+
+            passedCount = Scorer::filterSignatures(blockSignatures, blockCount, requiredSignature, passed);
+
+            for (int k = 0; k < passedCount; ++k) {
+                const int i = passed[k];
+                scores[i] = scoreSymbol(scorers.first(), terms.first(), indices[i]);
+            }
+        }
+
+        for (int k = 0; k < passedCount; ++k) {
+            const int i = passed[k];
+
+            // Fuzzy scores of terms are averaged, substring scores only depend on the name.
+            for (int j = 1; j < terms.size() && scores[i] != 0; ++j) {
+                const int score = scoreSymbol(scorers.at(j), terms.at(j), indices[i]);
+                scores[i] = score == 0 ? 0 : m_fuzzySearchEnabled ? scores[i] + score : score;
+            }
+
+            if (scores[i] == 0)
+                continue;
+
+            if (m_fuzzySearchEnabled)
+                scores[i] /= terms.size();
+
+            const char *name = m_symbolIndex->name(indices[i]);
+            hits.append({scores[i], indices[i], SearchHit::makeSortKey(name), name});
         }
     }
 
-    // Limit for very short queries.
-    // TODO: Show a notification about the reduced result set.
-    if (query.size() < 3) {
-        sql += QLatin1String("  LIMIT 1000");
+    if (terms.size() > 1 || token.isCanceled())
+        return hits;
+
+    const int scannedHitCount = hits.size();
+
+    mergeScopedHits(needle, hits);
+    mergeAcronymHits(needle, hits);
+
+    if (hits.size() < MinHitCount)
+        appendTypoHits(needle, hits);
+
+    if (!allowedTypeIds.isEmpty()) {
+        hits.erase(std::remove_if(hits.begin() + scannedHitCount, hits.end(),
+                                  [this, &allowedTypeIds](const SearchHit &hit) {
+            return !allowedTypeIds.at(m_symbolIndex->typeId(hit.index));
+        }), hits.end());
     }
 
-    // Make it safe to use in a SQL query.
-    QString sanitizedQuery = query;
-    sanitizedQuery.replace(QLatin1Char('\''), QLatin1String("''"));
-    m_db->prepare(sql.arg(sanitizedQuery));
+    if (isTabulatedQuery) {
+        if (hits.size() > TabulatedHitCount) {
+            std::nth_element(hits.begin(), hits.begin() + TabulatedHitCount, hits.end());
+            hits.resize(TabulatedHitCount);
+        }
 
-    QList<SearchResult> results;
-    while (m_db->next() && !token.isCanceled()) {
-        results.append({m_db->value(0).toString(),
-                        parseSymbolType(m_db->value(1).toString()),
-                        m_db->value(2).toString(), m_db->value(3).toString(),
-                        const_cast<Docset *>(this), m_db->value(4).toInt()});
+        QMutexLocker locker(&m_tabulatedHitsMutex);
+        if (m_preloadedQueries.contains(needle))
+            m_tabulatedHits.insert(tableKey, hits);
+        else
+            m_recentTabulatedHits.insert(tableKey, new QVector<SearchHit>(hits));
     }
 
-    return results;
+    return hits;
+}
+
+bool Docset::isTabulated(const SearchQuery &query)
+{
+    const QString str = query.query();
+    return !query.hasSymbolTypes() && !str.isEmpty() && str.size() <= MaxTabulatedQueryLength
+            && !str.contains(QLatin1Char(' '));
+}
+
+QVector<bool> Docset::symbolTypeFilter(const QStringList &symbolTypes) const
+{
+    QVector<bool> allowedTypeIds;
+
+    if (symbolTypes.isEmpty())
+        return allowedTypeIds;
+
+    // Types may be given by canonical names, or by aliases of those.
+    QStringList canonicalTypes;
+    for (const QString &symbolType : symbolTypes)
+        canonicalTypes.append(parseSymbolType(symbolType));
+
+    const QStringList typeNames = m_symbolIndex->typeNames();
+    for (const QString &typeName : typeNames) {
+        allowedTypeIds.append(symbolTypes.contains(typeName, Qt::CaseInsensitive)
+                              || canonicalTypes.contains(parseSymbolType(typeName), Qt::CaseInsensitive));
+    }
+
+    return allowedTypeIds;
+}
+
+int Docset::loadedSymbolCount() const
+{
+    // Never wait for the index to load.
+    if (!m_symbolIndexMutex.tryLock())
+        return -1;
+
+    const int count = m_symbolIndex != nullptr ? m_symbolIndex->count() : -1;
+    m_symbolIndexMutex.unlock();
+    return count;
+}
+
+QVector<SearchHit> Docset::prefixSearch(const SearchQuery &query) const
+{
+    // Keeps the lookup well under a millisecond for short and common prefixes.
+    static const int MaxCandidateCount = 1024;
+
+    QVector<SearchHit> hits;
+
+    if (loadedSymbolCount() < 0)
+        return hits;
+
+    const QByteArray needle = query.query().toUtf8();
+    if (needle.simplified().contains(' '))
+        return hits;
+
+    const Scorer scorer(needle, m_fuzzyMatchMode);
+    const QVector<bool> allowedTypeIds = symbolTypeFilter(query.symbolTypes());
+
+    const QVector<int> candidates = m_symbolIndex->prefixCandidates(scorer.needle(), MaxCandidateCount);
+    for (int index : candidates) {
+        if (!allowedTypeIds.isEmpty() && !allowedTypeIds.at(m_symbolIndex->typeId(index)))
+            continue;
+
+        const int score = scoreSymbol(scorer, needle, index);
+        if (score == 0)
+            continue;
+
+        const char *name = m_symbolIndex->name(index);
+        hits.append({score, index, SearchHit::makeSortKey(name), name});
+    }
+
+    return hits;
+}
+
+SearchResult Docset::searchResult(const SearchHit &hit) const
+{
+    return {QString::fromUtf8(hit.name, m_symbolIndex->nameLength(hit.index)),
+            parseSymbolType(m_symbolIndex->typeName(m_symbolIndex->typeId(hit.index))),
+            QString::fromUtf8(m_symbolIndex->path(hit.index)),
+            QString::fromUtf8(m_symbolIndex->fragment(hit.index)),
+            const_cast<Docset *>(this), hit.score};
 }
 
 QList<SearchResult> Docset::relatedLinks(const QUrl &url) const
 {
     QList<SearchResult> results;
 
+    if (!ensureDatabase())
+        return results;
+
     // Strip docset path and anchor from url
     const QString dir = documentPath();
     QString urlPath = url.path();
@@ -333,20 +608,29 @@ QList<SearchResult> Docset::relatedLinks(const QUrl &url) const
     // Prepare the query to look up all pages with the same url.
     QString sql;
     if (m_type == Docset::Type::Dash) {
-        sql = QStringLiteral("SELECT name, type, path"
+        sql = QStringLiteral("SELECT name, type, path, ''"
                              "  FROM searchIndex"
-                             "  WHERE path LIKE \"%1%%\" AND path <> \"%1\"");
+                             "  WHERE path LIKE ?1 || '%' AND path <> ?1");
     } else if (m_type == Docset::Type::ZDash) {
         sql = QStringLiteral("SELECT name, type, path, fragment"
                              "  FROM searchIndex"
-                             "  WHERE path = \"%1\" AND fragment IS NOT NULL");
+                             "  WHERE path = ?1 AND fragment IS NOT NULL");
     }
 
-    m_db->prepare(sql.arg(cleanUrl.toString()));
-    while (m_db->next()) {
-        results.append({m_db->value(0).toString(),
-                        parseSymbolType(m_db->value(1).toString()),
-                        m_db->value(2).toString(), m_db->value(3).toString(),
+    const Util::SQLiteConnectionPool::Connection db(m_connectionPool);
+    if (db.get() == nullptr)
+        return results;
+
+    Util::SQLiteStatement *stmt = db->cachedStatement(sql);
+    if (!stmt->bind(1, cleanUrl.toString())) {
+        qWarning("SQL Error: %s", qPrintable(stmt->lastError()));
+        return results;
+    }
+
+    while (stmt->next()) {
+        results.append({stmt->stringValue(0),
+                        parseSymbolType(stmt->stringValue(1)),
+                        stmt->stringValue(2), stmt->stringValue(3),
                         const_cast<Docset *>(this), 0});
     }
 
@@ -356,6 +640,214 @@ QList<SearchResult> Docset::relatedLinks(const QUrl &url) const
     return results;
 }
 
+// Substring search, or fuzzy search in one of the matcher modes.
+int Docset::scoringMode() const
+{
+    return m_fuzzySearchEnabled ? 1 + static_cast<int>(m_fuzzyMatchMode) : 0;
+}
+
+int Docset::scoreSymbol(const Scorer &scorer, const QByteArray &needle, int index) const
+{
+    if (m_fuzzySearchEnabled)
+        return scorer.score(m_symbolIndex->normalizedName(index), m_symbolIndex->nameLength(index));
+
+    return scoreSubstring(m_symbolIndex->name(index), m_symbolIndex->nameLength(index),
+                          needle.constData(), needle.size());
+}
+
+void Docset::mergeAcronymHits(const QByteArray &needle, QVector<SearchHit> &hits) const
+{
+    static const int MaxAcronymLength = 16;
+    static const int MaxCandidateCount = 1024;
+
+    if (needle.size() < 2 || needle.size() > MaxAcronymLength)
+        return;
+
+    QByteArray acronym = needle;
+    for (char &c : acronym) {
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        else if (!(c >= 'a' && c <= 'z') && !(c >= '0' && c <= '9'))
+            return;
+    }
+
+    const QVector<SymbolIndex::AcronymMatch> matches
+            = m_symbolIndex->acronymCandidates(acronym, MaxCandidateCount);
+    if (matches.isEmpty())
+        return;
+
+    // Abbreviated names score as if the query matched the abbreviated part from its start.
+    QHash<int, int> scores;
+    scores.reserve(matches.size());
+    for (const SymbolIndex::AcronymMatch &match : matches) {
+        const int score = m_fuzzySearchEnabled ? qMax(101, 200 - (match.length - needle.size()))
+                                               : -match.length;
+        scores.insert(match.index, score);
+    }
+
+    mergeBoostedHits(scores, hits);
+}
+
+// Members of the scopes given by a qualified query are looked up by their last component,
+// and then by their qualifiers, which may use different separators than the query.
+void Docset::mergeScopedHits(const QByteArray &needle, QVector<SearchHit> &hits) const
+{
+    const QVector<SymbolIndex::ScopedMatch> matches = m_symbolIndex->scopedCandidates(needle);
+    if (matches.isEmpty())
+        return;
+
+    int memberStart = needle.size();
+    while (memberStart > 0 && !Scorer::isScopeSeparator(needle.at(memberStart - 1)))
+        --memberStart;
+
+    const int memberLength = needle.size() - memberStart;
+
+    // Members score as if the query matched the member from its start.
+    QHash<int, int> scores;
+    scores.reserve(matches.size());
+    for (const SymbolIndex::ScopedMatch &match : matches) {
+        const int score = m_fuzzySearchEnabled ? qMax(101, 200 - (match.length - memberLength))
+                                               : -match.length;
+        scores.insert(match.index, score);
+    }
+
+    mergeBoostedHits(scores, hits);
+}
+
+// Raises scores of existing hits to the given ones, and appends the rest.
+void Docset::mergeBoostedHits(QHash<int, int> scores, QVector<SearchHit> &hits) const
+{
+    for (SearchHit &hit : hits) {
+        const auto it = scores.constFind(hit.index);
+        if (it == scores.cend())
+            continue;
+
+        hit.score = qMax(hit.score, it.value());
+        scores.erase(it);
+    }
+
+    for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+        const char *name = m_symbolIndex->name(it.key());
+        hits.append({it.value(), it.key(), SearchHit::makeSortKey(name), name});
+    }
+}
+
+void Docset::appendTypoHits(const QByteArray &needle, QVector<SearchHit> &hits) const
+{
+    // Shorter needles are too similar to too many names.
+    static const int MinNeedleLength = 4;
+    static const int MaxTypoHitCount = 50;
+
+    if (needle.size() < MinNeedleLength)
+        return;
+
+    const int maxDistance = needle.size() >= 8 ? 2 : 1;
+    const QVector<SymbolIndex::TypoMatch> matches
+            = m_symbolIndex->typoCandidates(needle, maxDistance, MaxTypoHitCount);
+
+    for (const SymbolIndex::TypoMatch &match : matches) {
+        const auto isSameHit = [&match](const SearchHit &hit) { return hit.index == match.index; };
+        if (std::any_of(hits.cbegin(), hits.cend(), isSameHit))
+            continue;
+
+        // Below any exact or fuzzy match, closer and shorter names first.
+        const int score = -10000 * (match.distance + 1) - m_symbolIndex->nameLength(match.index);
+        const char *name = m_symbolIndex->name(match.index);
+        hits.append({score, match.index, SearchHit::makeSortKey(name), name});
+    }
+}
+
+void Docset::preload(const CancellationToken &token) const
+{
+    // Pairs of characters are only tabulated for the most common starts of names.
+    static const int TabulatedPairCount = 32;
+
+    if (!ensureSymbolIndex(token))
+        return;
+
+    QStringList queries;
+    for (char c = 'a'; c <= 'z'; ++c)
+        queries.append(QString(QLatin1Char(c)));
+    for (char c = '0'; c <= '9'; ++c)
+        queries.append(QString(QLatin1Char(c)));
+
+    auto isQueryChar = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+    };
+
+    QHash<QByteArray, int> pairCounts;
+    for (int i = 0; i < m_symbolIndex->count(); ++i) {
+        const char *name = m_symbolIndex->normalizedName(i);
+        if (isQueryChar(name[0]) && isQueryChar(name[1]))
+            ++pairCounts[QByteArray(name, 2)];
+    }
+
+    QVector<QPair<int, QByteArray>> pairs;
+    for (auto it = pairCounts.cbegin(); it != pairCounts.cend(); ++it)
+        pairs.append({it.value(), it.key()});
+
+    const int pairCount = qMin(pairs.size(), TabulatedPairCount);
+    std::partial_sort(pairs.begin(), pairs.begin() + pairCount, pairs.end(),
+                      [](const QPair<int, QByteArray> &a, const QPair<int, QByteArray> &b) {
+        return a.first > b.first;
+    });
+
+    for (int i = 0; i < pairCount; ++i)
+        queries.append(QString::fromUtf8(pairs.at(i).second));
+
+    {
+        QMutexLocker locker(&m_tabulatedHitsMutex);
+        for (const QString &query : qAsConst(queries))
+            m_preloadedQueries.insert(query.toUtf8());
+    }
+
+    for (const QString &query : qAsConst(queries)) {
+        if (token.isCanceled())
+            return;
+
+        search(SearchQuery(query), token);
+    }
+}
+
+DocsetSnapshot Docset::snapshot() const
+{
+    DocsetSnapshot snapshot;
+    snapshot.path = m_path;
+    snapshot.name = m_name;
+    snapshot.title = m_title;
+    snapshot.keywords = m_keywords;
+    snapshot.version = m_version;
+    snapshot.revision = m_revision;
+    snapshot.feedUrl = m_feedUrl;
+    snapshot.iconPath = m_iconPath;
+    snapshot.indexFileUrl = m_indexFileUrl;
+    snapshot.javaScriptEnabled = m_javaScriptEnabled;
+
+    QMutexLocker locker(&m_databaseMutex);
+
+    snapshot.fileStamps = m_fileStamps;
+
+    if (m_hasSymbolCounts) {
+        snapshot.type = static_cast<int>(m_type);
+        snapshot.symbolStrings = m_symbolStrings;
+        snapshot.symbolCounts = m_symbolCounts;
+    }
+
+    return snapshot;
+}
+
+void Docset::setSymbolIndexFileName(const QString &fileName)
+{
+    QMutexLocker locker(&m_symbolIndexMutex);
+    m_symbolIndexFileName = fileName;
+}
+
+QVector<qint64> Docset::fileStamps() const
+{
+    QMutexLocker locker(&m_databaseMutex);
+    return m_fileStamps;
+}
+
 QUrl Docset::searchResultUrl(const SearchResult &result) const
 {
     return createPageUrl(result.urlPath, result.urlFragment);
@@ -406,18 +898,123 @@ void Docset::loadMetadata()
     }
 }
 
+bool Docset::ensureDatabase() const
+{
+    QMutexLocker locker(&m_databaseMutex);
+    return const_cast<Docset *>(this)->openDatabase();
+}
+
+// Symbol counts restored from a snapshot do not require the database.
+bool Docset::ensureSymbolCounts() const
+{
+    QMutexLocker locker(&m_databaseMutex);
+    return m_hasSymbolCounts || const_cast<Docset *>(this)->openDatabase();
+}
+
+// An interrupted load is retried by the next search. The database lock is only held
+// while it is opened, so that browsing the docset does not wait for the index.
+bool Docset::ensureSymbolIndex(const CancellationToken &token) const
+{
+    QMutexLocker locker(&m_symbolIndexMutex);
+
+    if (m_symbolIndex != nullptr)
+        return true;
+
+    auto self = const_cast<Docset *>(this);
+    if (self->mapSymbolIndex(m_symbolIndexFileName, fileStamps().mid(0, 2)))
+        return true;
+
+    if (!ensureDatabase() || !self->loadSymbolIndex(token))
+        return false;
+
+    // Next time the index is mapped without opening the database.
+    // Stamps are taken after opening, which may have modified the file.
+    if (!m_symbolIndexFileName.isEmpty()) {
+        const LoadTimeline::Scope scope(m_loadTimeline, "Save symbol index", m_path);
+        m_symbolIndex->save(m_symbolIndexFileName, fileStamps().mid(0, 2));
+    }
+
+    return true;
+}
+
+// Must be called with m_symbolIndexMutex locked. \a sourceStamps are of docSet.dsidx.
+bool Docset::mapSymbolIndex(const QString &fileName, const QVector<qint64> &sourceStamps)
+{
+    if (fileName.isEmpty())
+        return false;
+
+    const LoadTimeline::Scope scope(m_loadTimeline, "Map symbol index", m_path);
+
+    m_symbolIndex = SymbolIndex::map(fileName, sourceStamps);
+    return m_symbolIndex != nullptr;
+}
+
+// Must be called with m_databaseMutex locked. Only the first call opens the database,
+// later ones return its result. The type restored from a snapshot does not tell it.
+bool Docset::openDatabase()
+{
+    if (m_hasOpenedDatabase)
+        return m_isDatabaseOpen;
+
+    m_hasOpenedDatabase = true;
+
+    const QString databasePath
+            = QDir(m_path).filePath(QStringLiteral("Contents/Resources/docSet.dsidx"));
+
+    {
+        const LoadTimeline::Scope scope(m_loadTimeline, "Open database", m_path);
+
+        m_db = new Util::SQLiteDatabase(databasePath);
+
+        if (!m_db->isOpen()) {
+            qWarning("SQL Error: %s", qPrintable(m_db->lastError()));
+            return false;
+        }
+
+        m_type = m_db->tables().contains(QStringLiteral("searchIndex"), Qt::CaseInsensitive)
+                ? Type::Dash : Type::ZDash;
+    }
+
+    {
+        const LoadTimeline::Scope scope(m_loadTimeline, "Index check", m_path);
+
+        createIndex();
+
+        if (m_type == Docset::Type::ZDash) {
+            createView();
+        }
+    }
+
+    if (!m_hasSymbolCounts) {
+        const LoadTimeline::Scope scope(m_loadTimeline, "Symbol count", m_path);
+        countSymbols();
+        m_hasSymbolCounts = true;
+    }
+
+    // Creating the index modifies the database file.
+    m_fileStamps = DocsetSnapshot::fileStamps(m_path);
+
+    m_connectionPool = new Util::SQLiteConnectionPool(databasePath);
+    m_isDatabaseOpen = true;
+
+    qCDebug(log, "Opened database of docset '%s'.", qPrintable(m_name));
+    return true;
+}
+
 void Docset::countSymbols()
 {
     static const QString sql = QStringLiteral("SELECT type, COUNT(*)"
                                               "  FROM searchIndex"
                                               "  GROUP BY type");
-    if (!m_db->prepare(sql)) {
-        qWarning("SQL Error: %s", qPrintable(m_db->lastError()));
+
+    Util::SQLiteStatement stmt(m_db, sql);
+    if (!stmt.isValid()) {
+        qWarning("SQL Error: %s", qPrintable(stmt.lastError()));
         return;
     }
 
-    while (m_db->next()) {
-        const QString symbolTypeStr = m_db->value(0).toString();
+    while (stmt.next()) {
+        const QString symbolTypeStr = stmt.stringValue(0);
 
         // A workaround for https://github.com/zealdocs/zeal/issues/980.
         if (symbolTypeStr.isEmpty()) {
@@ -427,44 +1024,96 @@ void Docset::countSymbols()
 
         const QString symbolType = parseSymbolType(symbolTypeStr);
         m_symbolStrings.insertMulti(symbolType, symbolTypeStr);
-        m_symbolCounts[symbolType] += m_db->value(1).toInt();
+        m_symbolCounts[symbolType] += stmt.intValue(1);
     }
 }
 
 // TODO: Fetch and cache only portions of symbols
 void Docset::loadSymbols(const QString &symbolType) const
-{
-    // itPair is a QPair<QMap::const_iterator, QMap::const_iterator>, with itPair.first and itPair.second respectively
-    // pointing to the start and the end of the range of nodes having symbolType as key. It effectively represents a
-    // contiguous view over the nodes with a specified key.
-    for (auto itPair = qAsConst(m_symbolStrings).equal_range(symbolType); itPair.first != itPair.second; ++itPair.first)
-        loadSymbols(symbolType, itPair.first.value());
-}
-
-void Docset::loadSymbols(const QString &symbolType, const QString &symbolString) const
 {
     QString sql;
     if (m_type == Docset::Type::Dash) {
-        sql = QStringLiteral("SELECT name, path"
+        sql = QStringLiteral("SELECT name, path, ''"
                              "  FROM searchIndex"
-                             "  WHERE type='%1'"
+                             "  WHERE type = ?"
                              "  ORDER BY name");
     } else {
         sql = QStringLiteral("SELECT name, path, fragment"
                              "  FROM searchIndex"
-                             "  WHERE type='%1'"
+                             "  WHERE type = ?"
                              "  ORDER BY name");
     }
 
-    if (!m_db->prepare(sql.arg(symbolString))) {
-        qWarning("SQL Error: %s", qPrintable(m_db->lastError()));
+    const Util::SQLiteConnectionPool::Connection db(m_connectionPool);
+    if (db.get() == nullptr)
+        return;
+
+    Util::SQLiteStatement *stmt = db->cachedStatement(sql);
+    if (!stmt->isValid()) {
+        qWarning("SQL Error: %s", qPrintable(stmt->lastError()));
         return;
     }
 
     QMap<QString, QUrl> &symbols = m_symbols[symbolType];
-    while (m_db->next())
-        symbols.insertMulti(m_db->value(0).toString(),
-                            createPageUrl(m_db->value(1).toString(), m_db->value(2).toString()));
+
+    // itPair is a QPair<QMap::const_iterator, QMap::const_iterator>, with itPair.first and itPair.second respectively
+    // pointing to the start and the end of the range of nodes having symbolType as key. It effectively represents a
+    // contiguous view over the nodes with a specified key.
+    for (auto itPair = qAsConst(m_symbolStrings).equal_range(symbolType); itPair.first != itPair.second; ++itPair.first) {
+        stmt->reset();
+        if (!stmt->bind(1, itPair.first.value())) {
+            qWarning("SQL Error: %s", qPrintable(stmt->lastError()));
+            return;
+        }
+
+        while (stmt->next())
+            symbols.insertMulti(stmt->stringValue(0),
+                                createPageUrl(stmt->stringValue(1), stmt->stringValue(2)));
+    }
+}
+
+// Copies the whole search index into memory, so that searching does not go through SQLite.
+// Must be called with m_symbolIndexMutex locked, once the database is open. Only this uses
+// the main connection afterwards, other queries go through the connection pool.
+bool Docset::loadSymbolIndex(const CancellationToken &token)
+{
+    QString sql;
+    if (m_type == Docset::Type::Dash) {
+        sql = QStringLiteral("SELECT name, type, path, ''"
+                             "  FROM searchIndex");
+    } else {
+        sql = QStringLiteral("SELECT name, type, path, fragment"
+                             "  FROM searchIndex");
+    }
+
+    const LoadTimeline::Scope scope(m_loadTimeline, "Symbol index", m_path);
+    const InterruptGuard interruptGuard(m_db, token);
+
+    Util::SQLiteStatement stmt(m_db, sql);
+    if (!stmt.isValid()) {
+        qWarning("SQL Error: %s", qPrintable(stmt.lastError()));
+        return false;
+    }
+
+    // Values are copied into the index straight from SQLite memory.
+    QScopedPointer<SymbolIndex> symbolIndex(new SymbolIndex());
+    while (stmt.next()) {
+        symbolIndex->append(stmt.rawValue(0), stmt.rawValue(1), stmt.rawValue(2), stmt.rawValue(3));
+    }
+
+    switch (stmt.status()) {
+    case Util::SQLiteStatement::Status::Ok:
+        break;
+    case Util::SQLiteStatement::Status::Interrupted:
+        return false;
+    case Util::SQLiteStatement::Status::Error:
+        qWarning("SQL Error: %s", qPrintable(stmt.lastError()));
+        return false;
+    }
+
+    symbolIndex->squeeze();
+    m_symbolIndex = symbolIndex.take();
+    return true;
 }
 
 void Docset::createIndex()
@@ -479,12 +1128,12 @@ void Docset::createIndex()
     const QString columnName = m_type == Type::Dash ? QStringLiteral("name")
                                                     : QStringLiteral("ztokenname");
 
-    m_db->prepare(indexListQuery.arg(tableName));
+    Util::SQLiteStatement stmt(m_db, indexListQuery.arg(tableName));
 
     QStringList oldIndexes;
 
-    while (m_db->next()) {
-        const QString indexName = m_db->value(1).toString();
+    while (stmt.next()) {
+        const QString indexName = stmt.stringValue(1);
         if (!indexName.startsWith(IndexNamePrefix))
             continue;
 
@@ -697,258 +1346,52 @@ void Docset::setFuzzySearchEnabled(bool enabled)
     m_fuzzySearchEnabled = enabled;
 }
 
-bool Docset::isJavaScriptEnabled() const
+FuzzyMatcher::Mode Docset::fuzzyMatchMode() const
 {
-    return m_javaScriptEnabled;
+    return m_fuzzyMatchMode;
 }
 
-/**
- * \brief Returns score based on a substring position in a string.
- * \param str Original string.
- * \param index Index of the substring within \a str.
- * \param length Substring length.
- * \return Score value between 1 and 100.
- */
-static int scoreFuzzy(const char *str, int index, int length)
-{
-    // Score between 66..99, if the match follows a dot, or starts the string.
-    if (index == 0 || str[index - 1] == '.') {
-        return qMax(66, 100 - length);
-    }
-
-    // Score between 33..66, if the match is at the end of the string.
-    if (str[index + length] == 0) {
-        return qMax(33, 67 - length);
-    }
-
-    // Score between 1..33 otherwise (match in the middle of the string).
-    return qMax(1, 34 - length);
-}
-
-// Based on https://github.com/bevacqua/fuzzysearch
-static void matchFuzzy(const char *needle, int needleLength,
-                       const char *haystack, int haystackLength,
-                       int *start, int *length)
-{
-    static const int MaxDistance = 8;
-    static const int MaxGroupCount = 3;
-
-    *start = -1;
-
-    int groupCount = 0;
-    int bestRecursiveScore = -1;
-    int bestRecursiveStart = -1;
-    int bestRecursiveLength = -1;
-
-    for (int i = 0, j = 0; i < needleLength; ++i) {
-        bool found = false;
-        bool first = true;
-        int distance = 0;
-
-        while (j < haystackLength) {
-            if (needle[i] == haystack[j++]) {
-                if (*start == -1) {
-                    *start = j;  // first matched char
-
-                    // try starting the search later in case the first character occurs again later
-                    int recursiveStart;
-                    int recursiveLength;
-                    matchFuzzy(needle, needleLength, haystack + j,
-                               haystackLength - j,
-                               &recursiveStart, &recursiveLength);
-                    if (recursiveStart != -1) {
-                        int recursiveScore = scoreFuzzy(haystack,
-                                                        recursiveStart,
-                                                        recursiveLength);
-                        if (recursiveScore > bestRecursiveScore) {
-                            bestRecursiveScore = recursiveScore;
-                            bestRecursiveStart = recursiveStart;
-                            bestRecursiveLength = recursiveLength;
-                        }
-                    }
-                }
-
-                *length = j - *start + 1;
-                found = true;
-                break;
-            }
-
-            // Optimizations to reduce returned number of results
-            // (search was returning too many irrelevant results with large docsets)
-            // Optimization #1: too many mismatches.
-            if (first) {
-                if (++groupCount >= MaxGroupCount) {
-                    break;
-                }
-
-                first = false;
-            }
-
-            // Optimization #2: too large distance between found chars.
-            if (i != 0 && ++distance >= MaxDistance) {
-                break;
-            }
-        }
-
-        if (!found) {
-            // End of haystack, char not found.
-            if (bestRecursiveScore != -1) {
-                // Can still match with the same constraints if matching started later
-                // (smaller distance from first char to 2nd char)
-                *start = bestRecursiveStart;
-                *length = bestRecursiveLength;
-            } else {
-                *start = -1;
-            }
-            return;
-        }
-    }
-
-    int score = scoreFuzzy(haystack, *start, *length);
-    if (bestRecursiveScore > score) {
-        *start = bestRecursiveStart;
-        *length = bestRecursiveLength;
-    }
+void Docset::setFuzzyMatchMode(FuzzyMatcher::Mode mode)
+{
+    m_fuzzyMatchMode = mode;
 }
 
-// Ported from DevDocs (https://github.com/Thibaut/devdocs), see app/searcher.coffee.
-static int scoreExact(int matchIndex, int matchLen, const char *value, int valueLen)
+bool Docset::isJavaScriptEnabled() const
 {
-    static const char DOT = '.';
-
-    int score = 100;
-
-    // Remove one point for each unmatched character.
-    score -= (valueLen - matchLen);
-
-    if (matchIndex > 0) {
-        if (value[matchIndex - 1] == DOT) {
-            // If the character preceding the query is a dot, assign the same
-            // score as if the query was found at the beginning of the string,
-            // minus one.
-            score += matchIndex - 1;
-        } else if (matchLen == 1) {
-            // Don't match a single-character query unless it's found at the
-            // beginning of the string or is preceded by a dot.
-            return 0;
-        } else {
-            // (1) Remove one point for each unmatched character up to
-            //     the nearest preceding dot or the beginning of the
-            //     string.
-            // (2) Remove one point for each unmatched character
-            //     following the query.
-            int i = matchIndex - 2;
-            while (i >= 0 && value[i] != DOT)
-                --i;
-
-            score -= (matchIndex - i)                      // (1)
-                    + (valueLen - matchLen - matchIndex);  // (2)
-        }
-
-        // Remove one point for each dot preceding the query, except for the
-        // one immediately before the query.
-        for (int i = matchIndex - 2; i >= 0; --i) {
-            if (value[i] == DOT)
-                --score;
-        }
-    }
-
-    // Remove five points for each dot following the query.
-    for (int i = valueLen - matchLen - matchIndex - 1; i >= 0; --i) {
-        if (value[matchIndex + matchLen + i] == DOT)
-            score -= 5;
-    }
-
-    return qMax(1, score);
+    return m_javaScriptEnabled;
 }
 
-static inline int scoreFunction(const char *needleOrig, const char *haystackOrig)
+static inline char toLowerAscii(char c)
 {
-    const int needleLength = static_cast<int>(qstrlen(needleOrig));
-    const int haystackLength = static_cast<int>(qstrlen(haystackOrig));
-
-    QVarLengthArray<char, 1024> needle(needleLength + 1);
-    QVarLengthArray<char, 1024> haystack(haystackLength + 1);
-
-    for (int i = 0, j = 0; i <= needleLength; ++i, ++j) {
-        const char c = needleOrig[i];
-        if ((i > 0 && needleOrig[i - 1] == ':' && c == ':') // C++ (::)
-                || c == '/' || c == '_' || c == ' ') { // Go, some Guides
-            needle[j] = '.';
-        } else if (c >= 'A' && c <= 'Z')  {
-            needle[j] = c + 32;
-        } else {
-            needle[j] = c;
-        }
-    }
-
-    for (int i = 0, j = 0; i <= haystackLength; ++i, ++j) {
-        const char c = haystackOrig[i];
-        if ((i > 0 && haystackOrig[i - 1] == ':' && c == ':') // C++ (::)
-                || c == '/' || c == '_' || c == ' ') { // Go, some Guides
-            haystack[j] = '.';
-        } else if (c >= 'A' && c <= 'Z')  {
-            haystack[j] = c + 32;
-        } else {
-            haystack[j] = c;
-        }
-    }
-
-    int score = 0;
-    int matchIndex = -1;
-    int matchLength = 0;
-    int exactIndex = -1;
-    const char *exactMatch = std::strstr(haystack.data(), needle.data());
-
-    if (exactMatch != nullptr) {
-        exactIndex = exactMatch - haystack.data();
-    }
-
-    if (exactIndex == -1) {
-        matchFuzzy(needle.data(), needleLength,
-                   haystack.data(), haystackLength,
-                   &matchIndex, &matchLength);
-    }
+    return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
 
-    if (matchIndex == -1 && exactIndex == -1) {
-        // no match
-        return 0;
-    }
+/**
+ * \brief Emulates SQLite's "-length(name) ... WHERE name LIKE '%needle%'".
+ * \return Negative name length in characters, or 0 if there is no match.
+ *
+ * Same as SQLite's LIKE, the comparison is case-insensitive for ASCII characters only.
+ */
+static int scoreSubstring(const char *haystack, int haystackLength,
+                          const char *needle, int needleLength)
+{
+    for (int i = 0; i <= haystackLength - needleLength; ++i) {
+        int j = 0;
+        while (j < needleLength && toLowerAscii(haystack[i + j]) == toLowerAscii(needle[j]))
+            ++j;
 
-    if (exactIndex != -1) {
-        // +100 to make sure exact matches are always on top.
-        score = scoreExact(exactIndex, needleLength, haystack.data(), haystackLength) + 100;
-    } else {
-        score = scoreFuzzy(haystack.data(), matchIndex, matchLength);
+        if (j < needleLength)
+            continue;
 
-        int indexOfLastDot;
-        for (indexOfLastDot = haystackLength - 1; indexOfLastDot >= 0; --indexOfLastDot) {
-            if (haystack[indexOfLastDot] == '.')
-                break;
+        int score = 0;
+        for (int k = 0; k < haystackLength; ++k) {
+            // Do not count UTF-8 continuation bytes.
+            if ((haystack[k] & 0xc0) != 0x80)
+                --score;
         }
 
-        if (indexOfLastDot != -1) {
-            matchIndex = -1;
-            matchFuzzy(needle.data(), needleLength,
-                       haystack.data() + indexOfLastDot + 1, haystackLength - (indexOfLastDot + 1),
-                       &matchIndex, &matchLength);
-
-            if (matchIndex != -1) {
-                score = qMax(score, scoreFuzzy(haystack.data() + indexOfLastDot + 1,
-                                               matchIndex, matchLength));
-            }
-        }
+        return score;
     }
 
-    return score;
-}
-
-static void sqliteScoreFunction(sqlite3_context *context, int argc, sqlite3_value **argv)
-{
-    Q_UNUSED(argc);
-
-    auto needle = reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
-    auto haystack = reinterpret_cast<const char *>(sqlite3_value_text(argv[1]));
-
-    sqlite3_result_int(context, scoreFunction(needle, haystack));
+    return 0;
 }
@@ -24,27 +24,43 @@
 #ifndef DOCSET_H
 #define DOCSET_H
 
+#include "fuzzymatcher.h"
+#include "searchresult.h"
+
+#include <QCache>
+#include <QHash>
 #include <QIcon>
 #include <QMap>
 #include <QMetaObject>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
 #include <QUrl>
+#include <QVector>
 
 namespace Zeal {
 
 namespace Util {
+class SQLiteConnectionPool;
 class SQLiteDatabase;
 }
 
 namespace Registry {
 
 class CancellationToken;
-struct SearchResult;
+class LoadTimeline;
+class Scorer;
+struct DocsetSnapshot;
+class SymbolIndex;
+class SearchQuery;
 
 class Docset final
 {
     Q_DISABLE_COPY(Docset)
 public:
-    explicit Docset(QString path);
+    explicit Docset(QString path, LoadTimeline *loadTimeline = nullptr);
+    /// Restores a docset without reading its files, \a snapshot must be up to date.
+    explicit Docset(const DocsetSnapshot &snapshot, LoadTimeline *loadTimeline = nullptr);
     virtual ~Docset();
 
     bool isValid() const;
@@ -66,11 +82,55 @@ public:
     QMap<QString, int> symbolCounts() const;
     int symbolCount(const QString &symbolType) const;
 
+    /// Opens the database, unless it is already open, and returns whether it is. Blocks,
+    /// so the database can be opened in the background before symbols are browsed.
+    bool ensureDatabase() const;
     const QMap<QString, QUrl> &symbols(const QString &symbolType) const;
 
-    QList<SearchResult> search(const QString &query, const CancellationToken &token) const;
+    /// Returns unordered hits for all symbols matching \a query. If \a candidates is not
+    /// null, only symbols from the hits of an earlier query are considered. A query with
+    /// whitespace separated terms matches names that match every term. Members of the scopes
+    /// given by a qualified query, such as "QWidget.setGeo", are boosted or added regardless
+    /// of their scope separators. Symbols of types not given by the query are skipped before
+    /// scoring.
+    ///
+    /// For single term queries, names, whose word initials start with the query, are boosted
+    /// or added regardless. When there are only a few hits, names within one or two typos
+    /// from the query are added below them.
+    QVector<SearchHit> search(const SearchQuery &query, const CancellationToken &token,
+                              const QVector<SearchHit> *candidates = nullptr) const;
+
+    /// Queries of up to this many characters, without type filters, are answered with the
+    /// best TabulatedHitCount hits only. Those are computed once, and then looked up.
+    /// Queries tabulated by preload() are kept, the rest only while recently used.
+    static const int MaxTabulatedQueryLength = 2;
+    static const int TabulatedHitCount = 1000;
+    static const int RecentTabulatedQueryCount = 16;
+    static bool isTabulated(const SearchQuery &query);
+
+    /// Returns the number of symbols in the loaded symbol index, or -1 if it is not loaded yet.
+    /// Never blocks.
+    int loadedSymbolCount() const;
+
+    /// Returns hits for symbols, whose names or their last components start with \a query.
+    /// Returns nothing if the symbol index is not loaded yet, so this never blocks.
+    /// Queries with several terms are left to search(), since their terms match in any order.
+    QVector<SearchHit> prefixSearch(const SearchQuery &query) const;
+    SearchResult searchResult(const SearchHit &hit) const;
     QList<SearchResult> relatedLinks(const QUrl &url) const;
 
+    /// Opens the database and loads the symbol index ahead of the first search, and then
+    /// tabulates hits for single characters and common pairs of them. Otherwise this
+    /// happens on first use, which keeps docset registration cheap.
+    void preload(const CancellationToken &token) const;
+
+    /// Symbol index is saved into \a fileName, and mapped from it while the database is unchanged.
+    void setSymbolIndexFileName(const QString &fileName);
+
+    DocsetSnapshot snapshot() const;
+    /// Returns stamps of the files the docset was loaded from, see DocsetSnapshot.
+    QVector<qint64> fileStamps() const;
+
     // FIXME: This a temporary solution to create URL on demand.
     QUrl searchResultUrl(const SearchResult &result) const;
 
@@ -79,6 +139,8 @@ public:
 
     bool isFuzzySearchEnabled() const;
     void setFuzzySearchEnabled(bool enabled);
+    FuzzyMatcher::Mode fuzzyMatchMode() const;
+    void setFuzzyMatchMode(FuzzyMatcher::Mode mode);
 
     bool isJavaScriptEnabled() const;
 
@@ -90,9 +152,20 @@ private:
     };
 
     void loadMetadata();
+    bool ensureSymbolCounts() const;
+    bool ensureSymbolIndex(const CancellationToken &token) const;
+    bool openDatabase();
     void countSymbols();
     void loadSymbols(const QString &symbolType) const;
-    void loadSymbols(const QString &symbolType, const QString &symbolString) const;
+    bool loadSymbolIndex(const CancellationToken &token);
+    bool mapSymbolIndex(const QString &fileName, const QVector<qint64> &sourceStamps);
+    int scoringMode() const;
+    int scoreSymbol(const Scorer &scorer, const QByteArray &needle, int index) const;
+    QVector<bool> symbolTypeFilter(const QStringList &symbolTypes) const;
+    void mergeScopedHits(const QByteArray &needle, QVector<SearchHit> &hits) const;
+    void mergeAcronymHits(const QByteArray &needle, QVector<SearchHit> &hits) const;
+    void mergeBoostedHits(QHash<int, int> scores, QVector<SearchHit> &hits) const;
+    void appendTypoHits(const QByteArray &needle, QVector<SearchHit> &hits) const;
     void createIndex();
     void createView();
     QUrl createPageUrl(const QString &path, const QString &fragment = QString()) const;
@@ -105,17 +178,37 @@ private:
     QString m_version;
     QString m_revision;
     QString m_feedUrl;
-    Docset::Type m_type = Type::Invalid;
+    bool m_isValid = false;
+    Docset::Type m_type = Type::Invalid; // Known once the database is open, or from a snapshot.
     QString m_path;
     QIcon m_icon;
+    QString m_iconPath;
+    QVector<qint64> m_fileStamps; // When metadata and symbol counts were read.
+
+    LoadTimeline *m_loadTimeline = nullptr;
 
     QUrl m_indexFileUrl;
 
     QMap<QString, QString> m_symbolStrings;
     QMap<QString, int> m_symbolCounts;
+    bool m_hasSymbolCounts = false;
     mutable QMap<QString, QMap<QString, QUrl>> m_symbols;
+    mutable QMutex m_databaseMutex; // Guards opening the database, held only briefly.
+    mutable QMutex m_symbolIndexMutex; // Guards loading the index, taken before m_databaseMutex.
+    bool m_hasOpenedDatabase = false; // Whether opening has been attempted.
+    bool m_isDatabaseOpen = false;
     Util::SQLiteDatabase *m_db = nullptr;
+    Util::SQLiteConnectionPool *m_connectionPool = nullptr; // For concurrent readers.
+    SymbolIndex *m_symbolIndex = nullptr;
+    QString m_symbolIndexFileName;
+    // Best hits for short queries, keyed by the scoring mode and the query.
+    mutable QHash<QPair<int, QByteArray>, QVector<SearchHit>> m_tabulatedHits; // Preloaded.
+    mutable QCache<QPair<int, QByteArray>, QVector<SearchHit>> m_recentTabulatedHits{
+        RecentTabulatedQueryCount};
+    mutable QSet<QByteArray> m_preloadedQueries;
+    mutable QMutex m_tabulatedHitsMutex;
     bool m_fuzzySearchEnabled = false;
+    FuzzyMatcher::Mode m_fuzzyMatchMode = FuzzyMatcher::Mode::Compatible;
     bool m_javaScriptEnabled = false;
 };
 
@@ -28,27 +28,165 @@
 #include "searchquery.h"
 #include "searchresult.h"
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QRunnable>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 
 #include <QtConcurrent>
 
+#include <algorithm>
 #include <functional>
+#include <numeric>
 
 using namespace Zeal::Registry;
 
-void MergeQueryResults(QList<SearchResult> &finalResult, const QList<SearchResult> &partial)
+static Q_LOGGING_CATEGORY(log, "zeal.registry.docsetregistry")
+
+namespace {
+// Limits memory used by cached results of earlier queries.
+const int MaxQueryStageCount = 16;
+
+const int DefaultLoadConcurrency = 2;
+const int MaxRecentDocsetCount = 20;
+
+// Small docsets are searched together, so that scheduling does not outweigh scanning.
+const int MinBatchSymbolCount = 50000;
+
+// Time without changes in the storage before it is rescanned.
+const int RescanDelay = 1000; // ms
+
+// Speculative queries after each search: the most frequent next characters, and backspace.
+const int PrefetchNextCharacterCount = 3;
+const int PrefetchSampleHitCount = 5000; // Per docset, for counting next characters.
+const int PrefetchTimeBudget = 100; // ms
+
+// Returns the case-folded character following the first occurrence of \a term in \a name,
+// or 0 if there is none. \a term must be case-folded.
+uchar nextCharacter(const char *name, const QByteArray &term)
+{
+    for (const char *start = name; *start != 0; ++start) {
+        int i = 0;
+        while (i < term.size() && SearchHit::foldCase(start[i]) == static_cast<uchar>(term.at(i)))
+            ++i;
+
+        if (i == term.size())
+            return SearchHit::foldCase(start[i]);
+    }
+
+    return 0;
+}
+
+// Characters, which are likely to be typed next. Other ones would start a keyword filter,
+// or a new term.
+bool isPredictableCharacter(uchar c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+// Returns paths of docsets, and optionally of folders containing them.
+QStringList findDocsets(const QString &path, QStringList *folders = nullptr)
+{
+    QStringList paths;
+
+    const QDir dir(path);
+    const auto subDirectories = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllDirs);
+    for (const QFileInfo &subdir : subDirectories) {
+        if (subdir.suffix() == QLatin1String("docset")) {
+            paths.append(subdir.filePath());
+            continue;
+        }
+
+        if (folders != nullptr)
+            folders->append(subdir.filePath());
+
+        paths.append(findDocsets(subdir.filePath(), folders));
+    }
+
+    return paths;
+}
+
+// Returns file count, total size, and the latest modification time of a docset's contents.
+QVector<qint64> contentStamps(const QString &path)
+{
+    qint64 count = 0;
+    qint64 size = 0;
+    qint64 lastModified = 0;
+
+    QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fileInfo = it.fileInfo();
+        ++count;
+        size += fileInfo.size();
+        lastModified = qMax(lastModified, fileInfo.lastModified().toMSecsSinceEpoch());
+    }
+
+    return {count, size, lastModified};
+}
+
+// Lowers the priority of the pool thread it runs on.
+class LowerThreadPriority final : public QRunnable
 {
-    finalResult << partial;
+public:
+    void run() override
+    {
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+    }
+};
+
+// Sorts the next page of hits, only hits after \a from are considered.
+int sortHits(QVector<SearchHit> &hits, int from)
+{
+    const int to = qMin(hits.size(), from + DocsetRegistry::ResultPageSize);
+    std::partial_sort(hits.begin() + from, hits.begin() + to, hits.end());
+    return to;
 }
+} // namespace
+
+const int DocsetRegistry::ResultPageSize;
 
 DocsetRegistry::DocsetRegistry(QObject *parent)
     : QObject(parent)
     , m_model(new ListModel(this))
+    , m_storageWatcher(new QFileSystemWatcher(this))
+    , m_rescanTimer(new QTimer(this))
     , m_thread(new QThread(this))
+    , m_loadThreadPool(new QThreadPool(this))
+    , m_preloadThreadPool(new QThreadPool(this))
+    , m_prefetchThreadPool(new QThreadPool(this))
 {
     // Register for use in signal connections.
     qRegisterMetaType<QList<SearchResult>>("QList<SearchResult>");
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+
+    m_preloadThreadPool->setMaxThreadCount(1);
+
+    // Prefetching has its own thread, which never expires, so that it keeps the low priority
+    // set once here. Since it is a single thread, the priority task runs before any prefetch.
+    m_prefetchThreadPool->setMaxThreadCount(1);
+    m_prefetchThreadPool->setExpiryTimeout(-1);
+    m_prefetchThreadPool->start(new LowerThreadPriority());
+
+    // Loading is mostly disk-bound, so it does not use the global thread pool.
+    m_loadThreadPool->setMaxThreadCount(DefaultLoadConcurrency);
+
+    m_rescanTimer->setInterval(RescanDelay);
+    m_rescanTimer->setSingleShot(true);
+    connect(m_rescanTimer, &QTimer::timeout, this, &DocsetRegistry::_rescanStoragePath);
+    connect(m_storageWatcher, &QFileSystemWatcher::directoryChanged, this, [this] {
+        m_rescanTimer->start();
+    });
 
     // FIXME: Only search should be performed in a separate thread
     moveToThread(m_thread);
@@ -57,9 +195,27 @@ DocsetRegistry::DocsetRegistry(QObject *parent)
 
 DocsetRegistry::~DocsetRegistry()
 {
+    if (m_queryWatcher != nullptr) {
+        m_cancellationToken.cancel();
+        m_queryWatcher->waitForFinished();
+    }
+
+    if (m_prefetchWatcher != nullptr) {
+        m_prefetchCancellationToken.cancel();
+        m_prefetchWatcher->waitForFinished();
+    }
+
+    _finishSearchSession();
+
+    cancelPreload();
+    m_loadThreadPool->waitForDone();
+
+    saveSnapshot();
+
     m_thread->exit();
     m_thread->wait();
     qDeleteAll(m_docsets);
+    qDeleteAll(m_unloadedDocsets);
 }
 
 QAbstractItemModel *DocsetRegistry::model() const
@@ -78,10 +234,25 @@ void DocsetRegistry::setStoragePath(const QString &path)
         return;
     }
 
+    saveSnapshot();
+
     m_storagePath = path;
 
     unloadAllDocsets();
     addDocsetsFromFolder(path);
+
+    // Watcher and timer belong to the registry thread.
+    QMetaObject::invokeMethod(this, "_watchStoragePath", Qt::QueuedConnection);
+}
+
+QString DocsetRegistry::cachePath() const
+{
+    return m_cachePath;
+}
+
+void DocsetRegistry::setCachePath(const QString &path)
+{
+    m_cachePath = path;
 }
 
 bool DocsetRegistry::isFuzzySearchEnabled() const
@@ -102,6 +273,70 @@ void DocsetRegistry::setFuzzySearchEnabled(bool enabled)
     }
 }
 
+FuzzyMatcher::Mode DocsetRegistry::fuzzyMatchMode() const
+{
+    return m_fuzzyMatchMode;
+}
+
+void DocsetRegistry::setFuzzyMatchMode(FuzzyMatcher::Mode mode)
+{
+    if (mode == m_fuzzyMatchMode)
+        return;
+
+    m_fuzzyMatchMode = mode;
+
+    for (Docset *docset : qAsConst(m_docsets))
+        docset->setFuzzyMatchMode(mode);
+}
+
+bool DocsetRegistry::isDocsetPreloadEnabled() const
+{
+    return m_docsetPreloadEnabled;
+}
+
+void DocsetRegistry::setDocsetPreloadEnabled(bool enabled)
+{
+    if (enabled == m_docsetPreloadEnabled) {
+        return;
+    }
+
+    m_docsetPreloadEnabled = enabled;
+
+    if (!enabled) {
+        cancelPreload();
+        return;
+    }
+
+    for (Docset *docset : qAsConst(m_docsets)) {
+        preloadDocset(docset);
+    }
+}
+
+int DocsetRegistry::loadConcurrency() const
+{
+    return m_loadThreadPool->maxThreadCount();
+}
+
+void DocsetRegistry::setLoadConcurrency(int count)
+{
+    m_loadThreadPool->setMaxThreadCount(qMax(1, count));
+}
+
+QStringList DocsetRegistry::recentDocsets() const
+{
+    return m_recentDocsets;
+}
+
+void DocsetRegistry::setRecentDocsets(const QStringList &names)
+{
+    m_recentDocsets = names.mid(0, MaxRecentDocsetCount);
+}
+
+bool DocsetRegistry::saveLoadTimeline(const QString &fileName) const
+{
+    return m_loadTimeline.save(fileName);
+}
+
 int DocsetRegistry::count() const
 {
     return m_docsets.count();
@@ -120,9 +355,19 @@ QStringList DocsetRegistry::names() const
 void DocsetRegistry::loadDocset(const QString &path)
 {
     auto watcher = new QFutureWatcher<Docset *>();
-    connect(watcher, &QFutureWatcher<Docset *>::finished, this, [this, watcher] {
+    {
+        QMutexLocker locker(&m_loadingPathsMutex);
+        m_loadingPaths.insert(path);
+    }
+
+    connect(watcher, &QFutureWatcher<Docset *>::finished, this, [this, watcher, path] {
         QScopedPointer<QFutureWatcher<Docset *>, QScopedPointerDeleteLater> guard(watcher);
 
+        {
+            QMutexLocker locker(&m_loadingPathsMutex);
+            m_loadingPaths.remove(path);
+        }
+
         Docset *docset = watcher->result();
         // TODO: Emit error
         if (!docset->isValid()) {
@@ -133,34 +378,100 @@ void DocsetRegistry::loadDocset(const QString &path)
         }
 
         docset->setFuzzySearchEnabled(m_fuzzySearchEnabled);
+        docset->setFuzzyMatchMode(m_fuzzyMatchMode);
 
         const QString name = docset->name();
         if (m_docsets.contains(name)) {
             unloadDocset(name);
         }
 
+        // A replaced docset may have been renamed.
+        for (const Docset *oldDocset : m_docsets.values()) {
+            if (oldDocset->path() == docset->path()) {
+                unloadDocset(oldDocset->name());
+            }
+        }
+
         m_docsets[name] = docset;
         emit docsetLoaded(name);
+
+        if (m_docsetPreloadEnabled) {
+            preloadDocset(docset);
+        }
     });
 
-    watcher->setFuture(QtConcurrent::run([path] {
-        return new Docset(path);
+    const DocsetSnapshot snapshot = m_snapshots.take(path);
+    const QString indexFileName = symbolIndexFileName(path);
+    watcher->setFuture(QtConcurrent::run(m_loadThreadPool, [this, path, snapshot, indexFileName] {
+        // Validating a snapshot only takes a few file stats.
+        Docset *docset = snapshot.path == path && snapshot.isUpToDate()
+                ? new Docset(snapshot, &m_loadTimeline)
+                : new Docset(path, &m_loadTimeline);
+        docset->setSymbolIndexFileName(indexFileName);
+        return docset;
     }));
 }
 
+void DocsetRegistry::beginInstall(const QString &path)
+{
+    QMutexLocker locker(&m_loadingPathsMutex);
+    m_installingPaths.insert(path);
+}
+
+// Called after the installed docset is passed to loadDocset(), so that the path stays
+// excluded from rescans until it is loaded.
+void DocsetRegistry::endInstall(const QString &path)
+{
+    QMutexLocker locker(&m_loadingPathsMutex);
+    m_installingPaths.remove(path);
+}
+
 void DocsetRegistry::unloadDocset(const QString &name)
 {
+    // The docset may be in the preload queue, which is restarted for the remaining docsets.
+    cancelPreload();
+
     emit docsetAboutToBeUnloaded(name);
-    delete m_docsets.take(name);
+    Docset *docset = m_docsets.take(name);
     emit docsetUnloaded(name);
+
+    if (m_docsetPreloadEnabled) {
+        for (Docset *docset : qAsConst(m_docsets)) {
+            preloadDocset(docset);
+        }
+    }
+
+    if (docset == nullptr)
+        return;
+
+    // Running searches and cached matches may still refer to the docset,
+    // so it is deleted by the registry thread once they are done with it.
+    {
+        QMutexLocker locker(&m_unloadedDocsetsMutex);
+        m_unloadedDocsets.append(docset);
+    }
+
+    // Views get the signals above, and earlier results, through queued connections when this
+    // runs in the registry thread. The UI thread handles them before passing the deletion on.
+    QPointer<DocsetRegistry> registry(this);
+    QTimer::singleShot(0, QCoreApplication::instance(), [registry] {
+        if (registry != nullptr)
+            QMetaObject::invokeMethod(registry, "_deleteUnloadedDocsets", Qt::QueuedConnection);
+    });
 }
 
 void DocsetRegistry::unloadAllDocsets()
 {
+    // Do not restart the preload after each unloaded docset.
+    const bool docsetPreloadEnabled = m_docsetPreloadEnabled;
+    m_docsetPreloadEnabled = false;
+
     const auto keys = m_docsets.keys();
     for (const QString &name : keys) {
         unloadDocset(name);
     }
+
+    m_docsetPreloadEnabled = docsetPreloadEnabled;
 }
 
 Docset *DocsetRegistry::docset(const QString &name) const
@@ -183,60 +494,714 @@ QList<Docset *> DocsetRegistry::docsets() const
 void DocsetRegistry::search(const QString &query)
 {
     m_cancellationToken.cancel();
+    m_prefetchCancellationToken.cancel();
 
     if (query.isEmpty()) {
-        emit searchCompleted({});
+        emit searchStarted();
+        emit searchCompleted(false);
+        QMetaObject::invokeMethod(this, "_finishSearchSession", Qt::QueuedConnection);
         return;
     }
 
     QMetaObject::invokeMethod(this, "_runQuery", Qt::QueuedConnection, Q_ARG(QString, query));
 }
 
+void DocsetRegistry::fetchMoreResults(const QString &query, int offset)
+{
+    QMetaObject::invokeMethod(this, "_fetchMoreResults", Qt::QueuedConnection,
+                              Q_ARG(QString, query), Q_ARG(int, offset));
+}
+
 void DocsetRegistry::_runQuery(const QString &query)
 {
-    m_cancellationToken.reset();
+    // Cancel the previous query, so that waiting for it does not take long.
+    if (m_queryWatcher != nullptr) {
+        m_cancellationToken.cancel();
+        m_queryWatcher->waitForFinished();
+        delete m_queryWatcher;
+        m_queryWatcher = nullptr;
+    }
 
-    QList<Docset *> enabledDocsets;
+    // Same for prefetching, stages completed so far are kept.
+    QVector<QueryStage> prefetchedStages;
+    if (m_prefetchWatcher != nullptr) {
+        m_prefetchCancellationToken.cancel();
+        m_prefetchWatcher->waitForFinished();
+        prefetchedStages = m_prefetchWatcher->result();
+        delete m_prefetchWatcher;
+        m_prefetchWatcher = nullptr;
+    }
+
+    m_cancellationToken.reset();
+    m_prefetchCancellationToken.reset();
 
     const SearchQuery searchQuery = SearchQuery::fromString(query);
-    if (searchQuery.hasKeywords()) {
-        for (Docset *docset : qAsConst(m_docsets)) {
-            if (searchQuery.hasKeywords(docset->keywords()))
-                enabledDocsets << docset;
+    const QList<Docset *> enabledDocsets = this->enabledDocsets(searchQuery);
+
+    const QString coreQuery = searchQuery.query();
+
+    // Symbols matching a query also match its prefix in both substring and fuzzy modes,
+    // so only matches of the latest stage extended by this query need to be rescored.
+    // Stages for longer queries are dropped, which makes backspace hit the cache.
+    // Fuzzy search does not match anything with an empty query, so it is not refined.
+    // Short queries keep only the best hits, so their stages are reused as is, but not refined.
+    while (!m_queryStages.isEmpty()) {
+        const QueryStage &stage = m_queryStages.last();
+        if (stage.fuzzySearchEnabled == m_fuzzySearchEnabled
+                && stage.fuzzyMatchMode == m_fuzzyMatchMode && stage.docsets == enabledDocsets
+                && stage.symbolTypes == searchQuery.symbolTypes()
+                && (stage.query == coreQuery
+                    || (!stage.isTruncated && !stage.query.isEmpty()
+                        && coreQuery.startsWith(stage.query)))) {
+            break;
+        }
+
+        m_queryStages.removeLast();
+    }
+
+    // A prefetched stage extends remaining stages, just like the one a search would produce.
+    if (!prefetchedStages.isEmpty()
+            && (m_queryStages.isEmpty() || m_queryStages.last().query != coreQuery)) {
+        const auto it = std::find_if(prefetchedStages.cbegin(), prefetchedStages.cend(),
+                                     [this, &searchQuery, &enabledDocsets](const QueryStage &stage) {
+            return isStageOf(stage, searchQuery, enabledDocsets);
+        });
+
+        if (it != prefetchedStages.cend()) {
+            ++m_prefetchHitCount;
+
+            if (m_queryStages.size() == MaxQueryStageCount)
+                m_queryStages.removeFirst();
+
+            m_queryStages.append(*it);
+        } else {
+            ++m_prefetchMissCount;
+        }
+    }
+
+    emit searchStarted();
+
+    if (!m_queryStages.isEmpty() && m_queryStages.last().query == coreQuery) {
+        const QueryStage &stage = m_queryStages.last();
+        const int resultCount = qMin(stage.results.size(), ResultPageSize);
+
+        QVector<int> rows(resultCount);
+        std::iota(rows.begin(), rows.end(), 0);
+
+        emit searchResultsMerged(stage.results.mid(0, resultCount), rows, resultCount);
+        emit searchCompleted(resultCount < stage.hitCount);
+
+        startPrefetch();
+        return;
+    }
+
+    QList<Docset *> previousDocsets;
+    QVector<QVector<SearchHit>> previousHits;
+    if (!m_queryStages.isEmpty()) {
+        previousDocsets = m_queryStages.last().docsets;
+        previousHits = m_queryStages.last().hits;
+    }
+
+    // Each docset sorts only its first page of hits, which is bounded by the page size.
+    const std::function<QVector<DocsetQueryResults>(const QVector<int> &)> searchBatch
+            = [this, searchQuery, enabledDocsets, previousDocsets, previousHits](const QVector<int> &batch) {
+        QVector<DocsetQueryResults> batchResults;
+        for (int docsetIndex : batch) {
+            if (m_cancellationToken.isCanceled())
+                break;
+
+            Docset *docset = enabledDocsets.at(docsetIndex);
+
+            const QVector<SearchHit> *candidates = nullptr;
+            if (!previousDocsets.isEmpty())
+                candidates = &previousHits.at(previousDocsets.indexOf(docset));
+
+            DocsetQueryResults queryResults;
+            queryResults.docsetIndex = docsetIndex;
+            queryResults.hits = docset->search(searchQuery, m_cancellationToken, candidates);
+            queryResults.sortedHitCount = sortHits(queryResults.hits, 0);
+            batchResults.append(queryResults);
+        }
+
+        return batchResults;
+    };
+
+    // Docsets without a loaded index are assumed to be large.
+    QVector<QVector<int>> batches;
+    int batchSymbolCount = MinBatchSymbolCount;
+    for (int i = 0; i < enabledDocsets.size(); ++i) {
+        const int symbolCount = enabledDocsets.at(i)->loadedSymbolCount();
+        if (symbolCount < 0 || symbolCount >= MinBatchSymbolCount) {
+            batches.append({i});
+            continue;
         }
-    } else {
-        enabledDocsets = docsets();
+
+        if (batchSymbolCount >= MinBatchSymbolCount) {
+            batches.append(QVector<int>());
+            batchSymbolCount = 0;
+        }
+
+        batches.last().append(i);
+        batchSymbolCount += symbolCount;
+    }
+
+    m_runningQuery = query;
+    m_runningStage = QueryStage();
+    m_runningStage.query = coreQuery;
+    m_runningStage.symbolTypes = searchQuery.symbolTypes();
+    m_runningStage.fuzzySearchEnabled = m_fuzzySearchEnabled;
+    m_runningStage.fuzzyMatchMode = m_fuzzyMatchMode;
+    m_runningStage.isTruncated = Docset::isTabulated(searchQuery);
+    m_runningStage.docsets = enabledDocsets;
+    m_runningStage.hits.resize(enabledDocsets.size());
+    m_runningStage.sortedHitCounts.fill(0, enabledDocsets.size());
+    m_runningStage.mergedHitCounts.fill(0, enabledDocsets.size());
+    m_runningStageHits.clear();
+
+    // Refining earlier matches is fast enough on its own.
+    m_hasPrefixResults = false;
+    if (previousDocsets.isEmpty() && !coreQuery.isEmpty())
+        showPrefixResults(searchQuery, enabledDocsets);
+
+    // Results are merged as soon as a docset is done, so that a slow one does not delay others.
+    m_queryWatcher = new QFutureWatcher<QVector<DocsetQueryResults>>(this);
+    connect(m_queryWatcher, &QFutureWatcher<QVector<DocsetQueryResults>>::resultReadyAt,
+            this, &DocsetRegistry::mergeBatchResults);
+    connect(m_queryWatcher, &QFutureWatcher<QVector<DocsetQueryResults>>::finished,
+            this, &DocsetRegistry::finishQuery);
+    m_queryWatcher->setFuture(QtConcurrent::mapped(batches, searchBatch));
+}
+
+// Shows exact and prefix matches found through the symbol index before the full search.
+// They are scored the same way, so the full results mostly extend this list.
+void DocsetRegistry::showPrefixResults(const SearchQuery &query, const QList<Docset *> &docsets)
+{
+    QVector<QPair<SearchHit, Docset *>> hits;
+    for (Docset *docset : docsets) {
+        const QVector<SearchHit> docsetHits = docset->prefixSearch(query);
+        for (const SearchHit &hit : docsetHits)
+            hits.append({hit, docset});
     }
 
-    QFuture<QList<SearchResult>> queryResultsFuture
-            = QtConcurrent::mappedReduced(enabledDocsets,
-                                          std::bind(&Docset::search,
-                                                    std::placeholders::_1,
-                                                    searchQuery.query(),
-                                                    std::ref(m_cancellationToken)),
-                                          &MergeQueryResults);
-    QList<SearchResult> results = queryResultsFuture.result();
+    if (hits.isEmpty())
+        return;
+
+    const int count = qMin(hits.size(), ResultPageSize);
+    std::partial_sort(hits.begin(), hits.begin() + count, hits.end(),
+                      [](const QPair<SearchHit, Docset *> &a, const QPair<SearchHit, Docset *> &b) {
+        return a.first < b.first;
+    });
+
+    QList<SearchResult> results;
+    for (int i = 0; i < count; ++i)
+        results.append(hits.at(i).second->searchResult(hits.at(i).first));
+
+    QVector<int> rows(count);
+    std::iota(rows.begin(), rows.end(), 0);
+
+    m_hasPrefixResults = true;
+    emit searchResultsMerged(results, rows, count);
+}
 
+void DocsetRegistry::mergeBatchResults(int index)
+{
+    const QVector<DocsetQueryResults> batchResults = m_queryWatcher->resultAt(index);
+    for (const DocsetQueryResults &queryResults : batchResults)
+        mergeDocsetResults(queryResults);
+}
+
+// Inserts the first page of docset hits into current results, keeping at most one page.
+void DocsetRegistry::mergeDocsetResults(const DocsetQueryResults &queryResults)
+{
     if (m_cancellationToken.isCanceled())
         return;
 
-    std::sort(results.begin(), results.end());
+    const int index = queryResults.docsetIndex;
+    const QVector<SearchHit> &hits = queryResults.hits;
+    Docset *docset = m_runningStage.docsets.at(index);
+
+    m_runningStage.hits[index] = hits;
+    m_runningStage.sortedHitCounts[index] = queryResults.sortedHitCount;
+    m_runningStage.hitCount += hits.size();
+
+    QVector<SearchHit> mergedHits;
+    QList<SearchResult> mergedResults;
+    QList<SearchResult> newResults;
+    QVector<int> rows;
+
+    // Rows of new results are in ascending order, and existing rows keep their order.
+    int i = 0;
+    int j = 0;
+    while (mergedHits.size() < ResultPageSize) {
+        if (j < queryResults.sortedHitCount
+                && (i == m_runningStageHits.size() || hits.at(j) < m_runningStageHits.at(i))) {
+            rows.append(mergedHits.size());
+            newResults.append(docset->searchResult(hits.at(j)));
+            mergedResults.append(newResults.last());
+            mergedHits.append(hits.at(j++));
+        } else if (i < m_runningStageHits.size()) {
+            mergedResults.append(m_runningStage.results.at(i));
+            mergedHits.append(m_runningStageHits.at(i++));
+        } else {
+            break;
+        }
+    }
+
+    const bool truncated = i < m_runningStageHits.size();
+
+    m_runningStage.results = mergedResults;
+    m_runningStageHits = mergedHits;
+
+    if (newResults.isEmpty() && !truncated)
+        return;
+
+    // Nothing has been merged before, so restarting makes these results replace prefix matches.
+    if (m_hasPrefixResults) {
+        m_hasPrefixResults = false;
+        emit searchStarted();
+    }
+
+    emit searchResultsMerged(newResults, rows, mergedHits.size());
+}
 
+void DocsetRegistry::finishQuery()
+{
     if (m_cancellationToken.isCanceled())
         return;
 
-    emit searchCompleted(results);
+    // Top results of all docsets are the top results overall, so shown results
+    // are the first merged ones, and more can be fetched in the usual way.
+    // Prefix matches are not kept without full results.
+    if (m_hasPrefixResults) {
+        m_hasPrefixResults = false;
+        emit searchStarted();
+    }
+
+    QueryStage stage = m_runningStage;
+    for (const SearchResult &result : qAsConst(stage.results))
+        ++stage.mergedHitCounts[stage.docsets.indexOf(result.docset)];
+
+    if (!stage.results.isEmpty())
+        addRecentDocset(stage.results.first().docset->name());
+
+    m_runningStage = QueryStage();
+    m_runningStageHits.clear();
+
+    if (m_queryStages.size() == MaxQueryStageCount)
+        m_queryStages.removeFirst();
+
+    m_queryStages.append(stage);
+
+    emit searchCompleted(stage.results.size() < stage.hitCount);
+
+    startPrefetch();
+}
+
+// A session lasts until the query is cleared.
+void DocsetRegistry::_finishSearchSession()
+{
+    if (m_prefetchHitCount + m_prefetchMissCount == 0)
+        return;
+
+    qCDebug(log, "Prefetched query stages: %d hits, %d misses, %d%% hit rate.",
+            m_prefetchHitCount, m_prefetchMissCount,
+            100 * m_prefetchHitCount / (m_prefetchHitCount + m_prefetchMissCount));
+
+    m_prefetchHitCount = 0;
+    m_prefetchMissCount = 0;
+}
+
+// Each tab pages through results of its own query, which may be held by an earlier stage.
+// Nothing is fetched if the stage has been dropped since.
+void DocsetRegistry::_fetchMoreResults(const QString &query, int offset)
+{
+    const SearchQuery searchQuery = SearchQuery::fromString(query);
+    const QList<Docset *> docsets = enabledDocsets(searchQuery);
+
+    for (int i = m_queryStages.size() - 1; i >= 0; --i) {
+        QueryStage &stage = m_queryStages[i];
+        if (!isStageOf(stage, searchQuery, docsets))
+            continue;
+
+        mergeResults(stage, offset + ResultPageSize);
+
+        const QList<SearchResult> results = stage.results.mid(offset, ResultPageSize);
+        emit moreResultsFetched(query, offset, results, offset + results.size() < stage.hitCount);
+        return;
+    }
+}
+
+QList<Docset *> DocsetRegistry::enabledDocsets(const SearchQuery &query) const
+{
+    if (!query.hasKeywords())
+        return docsets();
+
+    QList<Docset *> docsets;
+    for (Docset *docset : qAsConst(m_docsets)) {
+        if (query.hasKeywords(docset->keywords()))
+            docsets << docset;
+    }
+
+    return docsets;
+}
+
+// Returns true if \a stage holds results of \a query for \a docsets in the current search mode.
+bool DocsetRegistry::isStageOf(const QueryStage &stage, const SearchQuery &query,
+                               const QList<Docset *> &docsets) const
+{
+    return stage.query == query.query() && stage.symbolTypes == query.symbolTypes()
+            && stage.fuzzySearchEnabled == m_fuzzySearchEnabled
+            && stage.fuzzyMatchMode == m_fuzzyMatchMode && stage.docsets == docsets;
+}
+
+void DocsetRegistry::_deleteUnloadedDocsets()
+{
+    QList<Docset *> docsets;
+    {
+        QMutexLocker locker(&m_unloadedDocsetsMutex);
+        docsets.swap(m_unloadedDocsets);
+    }
+
+    if (docsets.isEmpty())
+        return;
+
+    const auto refersToDocsets = [&docsets](const QueryStage &stage) {
+        return std::any_of(docsets.cbegin(), docsets.cend(), [&stage](Docset *docset) {
+            return stage.docsets.contains(docset);
+        });
+    };
+
+    // Results of the running query would be incomplete, so it is run again on the remaining
+    // docsets, unless a newer query has already canceled it.
+    bool isQueryInterrupted = false;
+    if (m_queryWatcher != nullptr && refersToDocsets(m_runningStage)) {
+        isQueryInterrupted = !m_cancellationToken.isCanceled();
+
+        m_cancellationToken.cancel();
+        m_queryWatcher->waitForFinished();
+        delete m_queryWatcher;
+        m_queryWatcher = nullptr;
+
+        m_runningStage = QueryStage();
+        m_runningStageHits.clear();
+    }
+
+    // Prefetched stages are dropped along with the cached ones.
+    if (m_prefetchWatcher != nullptr) {
+        m_prefetchCancellationToken.cancel();
+        m_prefetchWatcher->waitForFinished();
+        delete m_prefetchWatcher;
+        m_prefetchWatcher = nullptr;
+    }
+
+    m_queryStages.erase(std::remove_if(m_queryStages.begin(), m_queryStages.end(), refersToDocsets),
+                        m_queryStages.end());
+
+    qDeleteAll(docsets);
+
+    if (isQueryInterrupted)
+        _runQuery(m_runningQuery);
+}
+
+// Merges hits of all docsets in the stage, until there are \a count results.
+void DocsetRegistry::mergeResults(QueryStage &stage, int count)
+{
+    const auto &hits = stage.hits;
+    const auto &mergedHitCounts = stage.mergedHitCounts;
+
+    // Heap of docsets ordered by their next hit, with the best one on top.
+    const auto greaterThan = [&hits, &mergedHitCounts](int a, int b) {
+        return hits.at(b).at(mergedHitCounts.at(b)) < hits.at(a).at(mergedHitCounts.at(a));
+    };
+
+    // Hits are sorted a page at a time. A docset may have supplied all of its sorted hits
+    // to earlier pages, so its next page is sorted before it joins the heap.
+    QVector<int> heap;
+    for (int i = 0; i < hits.size(); ++i) {
+        if (mergedHitCounts.at(i) == hits.at(i).size())
+            continue;
+
+        if (mergedHitCounts.at(i) >= stage.sortedHitCounts.at(i))
+            stage.sortedHitCounts[i] = sortHits(stage.hits[i], mergedHitCounts.at(i));
+
+        heap.append(i);
+    }
+
+    std::make_heap(heap.begin(), heap.end(), greaterThan);
+
+    while (stage.results.size() < count && !heap.isEmpty()) {
+        std::pop_heap(heap.begin(), heap.end(), greaterThan);
+        const int i = heap.last();
+
+        stage.results.append(stage.docsets.at(i)->searchResult(hits.at(i).at(mergedHitCounts.at(i))));
+
+        if (++stage.mergedHitCounts[i] == hits.at(i).size()) {
+            heap.removeLast();
+            continue;
+        }
+
+        if (mergedHitCounts.at(i) >= stage.sortedHitCounts.at(i))
+            stage.sortedHitCounts[i] = sortHits(stage.hits[i], mergedHitCounts.at(i));
+
+        std::push_heap(heap.begin(), heap.end(), greaterThan);
+    }
+}
+
+// Speculatively searches for likely next queries at low priority, so that they are
+// answered from the cache. Any new query cancels this through m_prefetchCancellationToken.
+void DocsetRegistry::startPrefetch()
+{
+    const QueryStage &stage = m_queryStages.last();
+    if (stage.query.isEmpty() || m_cancellationToken.isCanceled())
+        return;
+
+    // Backspace is already answered by an earlier stage, if the query has been typed.
+    QString backspaceQuery = stage.query.left(stage.query.size() - 1).trimmed();
+    for (const QueryStage &earlierStage : qAsConst(m_queryStages)) {
+        if (earlierStage.query == backspaceQuery) {
+            backspaceQuery.clear();
+            break;
+        }
+    }
+
+    m_prefetchWatcher = new QFutureWatcher<QVector<QueryStage>>(this);
+    m_prefetchWatcher->setFuture(QtConcurrent::run(m_prefetchThreadPool, [this, stage, backspaceQuery] {
+        return prefetchQueryStages(stage, backspaceQuery);
+    }));
+}
+
+// Returns stages for the query extended by the characters that most often follow it in names
+// matched by \a stage, and then for \a backspaceQuery, unless it is empty. Only stages completed
+// within the time budget, and before cancellation, are returned.
+QVector<DocsetRegistry::QueryStage> DocsetRegistry::prefetchQueryStages(const QueryStage &stage,
+                                                                        const QString &backspaceQuery) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList queries;
+
+    // Characters are counted after the last term, since a new term is not predictable.
+    QByteArray term = stage.query.mid(stage.query.lastIndexOf(QLatin1Char(' ')) + 1).toUtf8();
+    for (char &c : term)
+        c = static_cast<char>(SearchHit::foldCase(c));
+
+    QVector<int> characterCounts(256, 0);
+    for (const QVector<SearchHit> &hits : stage.hits) {
+        const int count = qMin(hits.size(), PrefetchSampleHitCount);
+        for (int i = 0; i < count; ++i)
+            ++characterCounts[nextCharacter(hits.at(i).name, term)];
+    }
+
+    QVector<int> characters;
+    for (int c = 0; c < characterCounts.size(); ++c) {
+        if (characterCounts.at(c) > 0 && isPredictableCharacter(static_cast<uchar>(c)))
+            characters.append(c);
+    }
+
+    const int characterCount = qMin(characters.size(), PrefetchNextCharacterCount);
+    std::partial_sort(characters.begin(), characters.begin() + characterCount, characters.end(),
+                      [&characterCounts](int a, int b) {
+        return characterCounts.at(a) > characterCounts.at(b);
+    });
+
+    for (int i = 0; i < characterCount; ++i)
+        queries.append(stage.query + QLatin1Char(static_cast<char>(characters.at(i))));
+
+    // Extended queries are cheap refinements, so they go first.
+    if (!backspaceQuery.isEmpty())
+        queries.append(backspaceQuery);
+
+    QVector<QueryStage> stages;
+    for (const QString &query : qAsConst(queries)) {
+        SearchQuery searchQuery(query);
+        searchQuery.setSymbolTypes(stage.symbolTypes);
+
+        // Same rules as for refining stages of typed queries.
+        const bool isRefined = !stage.isTruncated && query.startsWith(stage.query);
+
+        QueryStage prefetchedStage;
+        prefetchedStage.query = query;
+        prefetchedStage.symbolTypes = stage.symbolTypes;
+        prefetchedStage.fuzzySearchEnabled = stage.fuzzySearchEnabled;
+        prefetchedStage.fuzzyMatchMode = stage.fuzzyMatchMode;
+        prefetchedStage.isTruncated = Docset::isTabulated(searchQuery);
+        prefetchedStage.docsets = stage.docsets;
+        prefetchedStage.hits.resize(stage.docsets.size());
+        prefetchedStage.sortedHitCounts.fill(0, stage.docsets.size());
+        prefetchedStage.mergedHitCounts.fill(0, stage.docsets.size());
+
+        for (int i = 0; i < stage.docsets.size(); ++i) {
+            if (m_prefetchCancellationToken.isCanceled() || timer.hasExpired(PrefetchTimeBudget))
+                return stages;
+
+            const QVector<SearchHit> *candidates = isRefined ? &stage.hits.at(i) : nullptr;
+            prefetchedStage.hits[i] = stage.docsets.at(i)->search(searchQuery, m_prefetchCancellationToken,
+                                                                  candidates);
+            prefetchedStage.sortedHitCounts[i] = sortHits(prefetchedStage.hits[i], 0);
+            prefetchedStage.hitCount += prefetchedStage.hits.at(i).size();
+        }
+
+        // Hits of a canceled search are incomplete.
+        if (m_prefetchCancellationToken.isCanceled())
+            break;
+
+        mergeResults(prefetchedStage, ResultPageSize);
+        stages.append(prefetchedStage);
+    }
+
+    return stages;
 }
 
 // Recursively finds and adds all docsets in a given directory.
 void DocsetRegistry::addDocsetsFromFolder(const QString &path)
 {
-    const QDir dir(path);
-    const auto subDirectories = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllDirs);
-    for (const QFileInfo &subdir : subDirectories) {
-        if (subdir.suffix() == QLatin1String("docset"))
-            loadDocset(subdir.filePath());
-        else
-            addDocsetsFromFolder(subdir.filePath());
+    if (!m_cachePath.isEmpty())
+        m_snapshots = DocsetSnapshot::load(snapshotFileName());
+
+    QStringList paths = findDocsets(path);
+
+    // Docsets are loaded in queue order, so recently searched ones are queued first.
+    // Docset names are not known before loading, but usually match directory names.
+    QHash<QString, int> ranks;
+    for (int i = 0; i < m_recentDocsets.size(); ++i)
+        ranks.insert(m_recentDocsets.at(i), i);
+
+    std::stable_sort(paths.begin(), paths.end(), [&ranks](const QString &a, const QString &b) {
+        return ranks.value(QFileInfo(a).completeBaseName(), MaxRecentDocsetCount)
+                < ranks.value(QFileInfo(b).completeBaseName(), MaxRecentDocsetCount);
+    });
+
+    for (const QString &docsetPath : qAsConst(paths)) {
+        loadDocset(docsetPath);
     }
 }
+
+void DocsetRegistry::_watchStoragePath()
+{
+    const QStringList watchedPaths = m_storageWatcher->directories();
+    if (!watchedPaths.isEmpty())
+        m_storageWatcher->removePaths(watchedPaths);
+
+    m_rescanTimer->stop();
+    m_settlingDocsets.clear();
+
+    if (m_storagePath.isEmpty())
+        return;
+
+    QStringList folders = {m_storagePath};
+    findDocsets(m_storagePath, &folders);
+    m_storageWatcher->addPaths(folders);
+}
+
+// Applies changes without touching docsets that stayed the same. New and replaced
+// docsets are loaded once their contents have not changed since the previous rescan.
+// Docsets written by the installer are loaded by it, and skipped here.
+void DocsetRegistry::_rescanStoragePath()
+{
+    QStringList folders = {m_storagePath};
+    const QStringList paths = findDocsets(m_storagePath, &folders);
+
+    // Watch new folders too.
+    const QStringList watchedFolders = m_storageWatcher->directories();
+    for (const QString &folder : qAsConst(folders)) {
+        if (!watchedFolders.contains(folder))
+            m_storageWatcher->addPath(folder);
+    }
+
+    QSet<QString> unchangedPaths;
+    for (const Docset *docset : m_docsets.values()) {
+        if (!paths.contains(docset->path())) {
+            unloadDocset(docset->name());
+            continue;
+        }
+
+        if (docset->fileStamps() == DocsetSnapshot::fileStamps(docset->path()))
+            unchangedPaths.insert(docset->path());
+    }
+
+    bool isSettled = true;
+
+    QSet<QString> busyPaths;
+    {
+        QMutexLocker locker(&m_loadingPathsMutex);
+        busyPaths = m_loadingPaths + m_installingPaths;
+    }
+
+    QHash<QString, QVector<qint64>> settlingDocsets;
+    for (const QString &path : paths) {
+        if (unchangedPaths.contains(path) || busyPaths.contains(path))
+            continue;
+
+        const QVector<qint64> stamps = contentStamps(path);
+        if (m_settlingDocsets.value(path) != stamps) {
+            settlingDocsets.insert(path, stamps);
+            isSettled = false;
+            continue;
+        }
+
+        // Replaced docsets are unloaded once the new ones are loaded.
+        loadDocset(path);
+    }
+
+    m_settlingDocsets = settlingDocsets;
+
+    if (!isSettled)
+        m_rescanTimer->start();
+}
+
+void DocsetRegistry::addRecentDocset(const QString &name)
+{
+    if (!m_recentDocsets.isEmpty() && m_recentDocsets.first() == name)
+        return;
+
+    m_recentDocsets.removeOne(name);
+    m_recentDocsets.prepend(name);
+
+    if (m_recentDocsets.size() > MaxRecentDocsetCount)
+        m_recentDocsets.removeLast();
+}
+
+void DocsetRegistry::saveSnapshot() const
+{
+    if (m_cachePath.isEmpty() || m_docsets.isEmpty())
+        return;
+
+    QList<DocsetSnapshot> snapshots;
+    for (const Docset *docset : m_docsets)
+        snapshots.append(docset->snapshot());
+
+    DocsetSnapshot::save(snapshotFileName(), snapshots);
+}
+
+QString DocsetRegistry::snapshotFileName() const
+{
+    return QDir(m_cachePath).filePath(QStringLiteral("docsets.snapshot"));
+}
+
+// Docset directories may be read-only, so indexes are kept in the cache.
+QString DocsetRegistry::symbolIndexFileName(const QString &docsetPath) const
+{
+    if (m_cachePath.isEmpty())
+        return QString();
+
+    const QByteArray hash = QCryptographicHash::hash(QFileInfo(docsetPath).absoluteFilePath().toUtf8(),
+                                                     QCryptographicHash::Sha1).toHex();
+    return QDir(m_cachePath).filePath(QStringLiteral("indexes/%1.zsi").arg(QString::fromLatin1(hash)));
+}
+
+void DocsetRegistry::preloadDocset(Docset *docset)
+{
+    QtConcurrent::run(m_preloadThreadPool, [this, docset] {
+        docset->preload(m_preloadCancellationToken);
+    });
+}
+
+// Blocks until a running preload is interrupted, queued ones are dropped.
+void DocsetRegistry::cancelPreload()
+{
+    m_preloadCancellationToken.cancel();
+    m_preloadThreadPool->clear();
+    m_preloadThreadPool->waitForDone();
+    m_preloadCancellationToken.reset();
+}
@@ -25,18 +25,29 @@
 #define DOCSETREGISTRY_H
 
 #include "cancellationtoken.h"
+#include "docsetsnapshot.h"
+#include "fuzzymatcher.h"
+#include "loadtimeline.h"
+#include "searchresult.h"
 
+#include <QFutureWatcher>
 #include <QMap>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QVector>
 
 class QAbstractItemModel;
+class QFileSystemWatcher;
 class QThread;
+class QThreadPool;
+class QTimer;
 
 namespace Zeal {
 namespace Registry {
 
 class Docset;
-struct SearchResult;
+class SearchQuery;
 
 class DocsetRegistry final : public QObject
 {
@@ -51,8 +62,30 @@ public:
     QString storagePath() const;
     void setStoragePath(const QString &path);
 
+    // Holds the docset snapshot file, which is used to restore docsets with unchanged files,
+    // and symbol indexes that are mapped instead of being loaded from SQLite.
+    QString cachePath() const;
+    void setCachePath(const QString &path);
+
     bool isFuzzySearchEnabled() const;
     void setFuzzySearchEnabled(bool enabled);
+    // Fuzzy matches are ranked as before by default, or by their best scoring position.
+    FuzzyMatcher::Mode fuzzyMatchMode() const;
+    void setFuzzyMatchMode(FuzzyMatcher::Mode mode);
+
+    // Docsets are opened on first use, unless they are preloaded in the background.
+    bool isDocsetPreloadEnabled() const;
+    void setDocsetPreloadEnabled(bool enabled);
+
+    // Maximum number of docsets read from disk at once.
+    int loadConcurrency() const;
+    void setLoadConcurrency(int count);
+
+    // Names of recently searched docsets, which are loaded first.
+    QStringList recentDocsets() const;
+    void setRecentDocsets(const QStringList &names);
+
+    bool saveLoadTimeline(const QString &fileName) const;
 
     int count() const;
     bool contains(const QString &name) const;
@@ -62,34 +95,136 @@ public:
     void unloadDocset(const QString &name);
     void unloadAllDocsets();
 
+    // Storage changes under \a path are ignored, while an installer is writing it.
+    void beginInstall(const QString &path);
+    void endInstall(const QString &path);
+
     Docset *docset(const QString &name) const;
     Docset *docset(int index) const;
     QList<Docset *> docsets() const;
 
+    // Number of results delivered at once, the rest is fetched on demand.
+    static const int ResultPageSize = 100;
+
     void search(const QString &query);
+    // Requests the page of results following the first \a offset ones of \a query.
+    void fetchMoreResults(const QString &query, int offset);
     const QList<SearchResult> &queryResults();
 
 signals:
     void docsetLoaded(const QString &name);
     void docsetAboutToBeUnloaded(const QString &name);
     void docsetUnloaded(const QString &name);
-    void searchCompleted(const QList<SearchResult> &results);
+    // Results of a query are streamed as docsets finish searching. New results are
+    // inserted at the given rows, and then rows past the row count are removed.
+    // Prefix matches may be shown first, then the search is started again to replace them.
+    void searchStarted();
+    void searchResultsMerged(const QList<SearchResult> &results, const QVector<int> &rows, int rowCount);
+    void searchCompleted(bool hasMoreResults);
+    // Several views may page through results, so each page is tagged with its request.
+    void moreResultsFetched(const QString &query, int offset, const QList<SearchResult> &results,
+                            bool hasMoreResults);
 
 private slots:
     void _runQuery(const QString &query);
+    void _fetchMoreResults(const QString &query, int offset);
+    void _finishSearchSession();
+    void _deleteUnloadedDocsets();
+    void _watchStoragePath();
+    void _rescanStoragePath();
 
 private:
+    struct DocsetQueryResults {
+        int docsetIndex = 0;
+        QVector<SearchHit> hits;
+        int sortedHitCount = 0;
+    };
+
+    // Matches of an earlier query, which are refined while the user keeps typing.
+    struct QueryStage {
+        QString query;
+        QStringList symbolTypes;
+        bool fuzzySearchEnabled = false;
+        FuzzyMatcher::Mode fuzzyMatchMode = FuzzyMatcher::Mode::Compatible;
+        bool isTruncated = false; // Only the best hits of each docset, see Docset::isTabulated().
+
+        QList<Docset *> docsets;
+
+        // Hits for each docset, sorted only up to the corresponding sortedHitCounts item.
+        QVector<QVector<SearchHit>> hits;
+        QVector<int> sortedHitCounts;
+        QVector<int> mergedHitCounts;
+        int hitCount = 0;
+
+        QList<SearchResult> results; // Merged so far.
+    };
+
+    QList<Docset *> enabledDocsets(const SearchQuery &query) const;
+    bool isStageOf(const QueryStage &stage, const SearchQuery &query,
+                   const QList<Docset *> &docsets) const;
+
+    void showPrefixResults(const SearchQuery &query, const QList<Docset *> &docsets);
+    void mergeBatchResults(int index);
+    void mergeDocsetResults(const DocsetQueryResults &queryResults);
+    void finishQuery();
+    static void mergeResults(QueryStage &stage, int count);
+
+    void startPrefetch();
+    QVector<QueryStage> prefetchQueryStages(const QueryStage &stage, const QString &backspaceQuery) const;
+
     void addDocsetsFromFolder(const QString &path);
+    void addRecentDocset(const QString &name);
+    QString snapshotFileName() const;
+    QString symbolIndexFileName(const QString &docsetPath) const;
+    void saveSnapshot() const;
+
+    void preloadDocset(Docset *docset);
+    void cancelPreload();
 
     QAbstractItemModel *m_model = nullptr;
 
     QString m_storagePath;
+    QString m_cachePath;
+    QHash<QString, DocsetSnapshot> m_snapshots; // Not yet restored docsets, keyed by path.
+
+    // External changes to the storage are applied once files stop changing.
+    QFileSystemWatcher *m_storageWatcher = nullptr;
+    QTimer *m_rescanTimer = nullptr;
+    QHash<QString, QVector<qint64>> m_settlingDocsets; // Content stamps seen by the last rescan.
+    QSet<QString> m_loadingPaths;
+    QSet<QString> m_installingPaths;
+    QMutex m_loadingPathsMutex; // Guards m_loadingPaths and m_installingPaths.
     bool m_fuzzySearchEnabled = false;
+    FuzzyMatcher::Mode m_fuzzyMatchMode = FuzzyMatcher::Mode::Compatible;
+    bool m_docsetPreloadEnabled = false;
 
     QThread *m_thread = nullptr;
     QMap<QString, Docset *> m_docsets;
+    QList<Docset *> m_unloadedDocsets; // Deleted by the registry thread.
+    QMutex m_unloadedDocsetsMutex;
+
+    QThreadPool *m_loadThreadPool = nullptr;
+    QStringList m_recentDocsets;
+    LoadTimeline m_loadTimeline;
+
+    QThreadPool *m_preloadThreadPool = nullptr; // Single thread, so that searches are not starved.
+    CancellationToken m_preloadCancellationToken;
 
     CancellationToken m_cancellationToken;
+    QFutureWatcher<QVector<DocsetQueryResults>> *m_queryWatcher = nullptr;
+    QString m_runningQuery; // As typed, for running it again on the remaining docsets.
+    QueryStage m_runningStage;
+    QVector<SearchHit> m_runningStageHits; // Hits of results merged so far.
+    QVector<QueryStage> m_queryStages;
+    bool m_hasPrefixResults = false; // Shown until the first docset finishes the full search.
+
+    // Stages for likely next queries, computed at low priority while the user is idle.
+    QThreadPool *m_prefetchThreadPool = nullptr;
+    CancellationToken m_prefetchCancellationToken;
+    QFutureWatcher<QVector<QueryStage>> *m_prefetchWatcher = nullptr;
+    // Queries of the current search session answered by prefetched stages, or not.
+    int m_prefetchHitCount = 0;
+    int m_prefetchMissCount = 0;
 };
 
 } // namespace Registry
@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#include "docsetsnapshot.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace Zeal::Registry;
+
+namespace {
+const quint32 SnapshotMagic = 0x5a445353; // ZDSS - Zeal docset snapshot
+// Must be increased on any change to the snapshot contents.
+const quint32 SnapshotVersion = 1;
+const QDataStream::Version SnapshotStreamVersion = QDataStream::Qt_5_9;
+} // namespace
+
+bool DocsetSnapshot::isUpToDate() const
+{
+    return !fileStamps.isEmpty() && fileStamps == DocsetSnapshot::fileStamps(path);
+}
+
+QVector<qint64> DocsetSnapshot::fileStamps(const QString &docsetPath)
+{
+    const QDir dir(docsetPath);
+
+    // TODO: 'info.plist' is invalid according to Apple, but still used by some docsets.
+    QFileInfo infoPlist(dir.filePath(QStringLiteral("Contents/Info.plist")));
+    if (!infoPlist.exists())
+        infoPlist.setFile(dir.filePath(QStringLiteral("Contents/info.plist")));
+
+    const QFileInfo files[] = {
+        QFileInfo(dir.filePath(QStringLiteral("Contents/Resources/docSet.dsidx"))),
+        QFileInfo(dir.filePath(QStringLiteral("meta.json"))),
+        infoPlist
+    };
+
+    QVector<qint64> stamps;
+    for (const QFileInfo &fi : files) {
+        if (!fi.exists()) {
+            stamps << -1 << -1;
+            continue;
+        }
+
+        stamps << fi.size() << fi.lastModified().toMSecsSinceEpoch();
+    }
+
+    return stamps;
+}
+
+QHash<QString, DocsetSnapshot> DocsetSnapshot::load(const QString &fileName)
+{
+    QHash<QString, DocsetSnapshot> snapshots;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return snapshots;
+
+    QDataStream in(&file);
+    in.setVersion(SnapshotStreamVersion);
+
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
+    if (magic != SnapshotMagic || version != SnapshotVersion)
+        return snapshots;
+
+    QList<DocsetSnapshot> list;
+    in >> list;
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning("Docset snapshot '%s' is corrupted.", qPrintable(fileName));
+        return snapshots;
+    }
+
+    for (const DocsetSnapshot &snapshot : qAsConst(list))
+        snapshots.insert(snapshot.path, snapshot);
+
+    return snapshots;
+}
+
+bool DocsetSnapshot::save(const QString &fileName, const QList<DocsetSnapshot> &snapshots)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot save docset snapshot to '%s': %s",
+                 qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(SnapshotStreamVersion);
+    out << SnapshotMagic << SnapshotVersion << snapshots;
+
+    return file.commit();
+}
+
+QDataStream &operator<<(QDataStream &out, const Zeal::Registry::DocsetSnapshot &snapshot)
+{
+    out << snapshot.path << snapshot.fileStamps
+        << snapshot.name << snapshot.title << snapshot.keywords
+        << snapshot.version << snapshot.revision << snapshot.feedUrl
+        << snapshot.iconPath << snapshot.indexFileUrl << snapshot.javaScriptEnabled
+        << snapshot.type << snapshot.symbolStrings << snapshot.symbolCounts;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, Zeal::Registry::DocsetSnapshot &snapshot)
+{
+    in >> snapshot.path >> snapshot.fileStamps
+       >> snapshot.name >> snapshot.title >> snapshot.keywords
+       >> snapshot.version >> snapshot.revision >> snapshot.feedUrl
+       >> snapshot.iconPath >> snapshot.indexFileUrl >> snapshot.javaScriptEnabled
+       >> snapshot.type >> snapshot.symbolStrings >> snapshot.symbolCounts;
+    return in;
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#ifndef ZEAL_REGISTRY_DOCSETSNAPSHOT_H
+#define ZEAL_REGISTRY_DOCSETSNAPSHOT_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+
+class QDataStream;
+
+namespace Zeal {
+namespace Registry {
+
+/**
+ * @short State of a docset derived from its files.
+ *
+ * Snapshots of all docsets are saved in a single cache file, so that on the
+ * next start docsets are registered without parsing their metadata or
+ * counting symbols. A snapshot is only used while the size and modification
+ * time of the docset files it was derived from stay the same.
+ */
+struct DocsetSnapshot
+{
+    QString path;
+    QVector<qint64> fileStamps;
+
+    QString name;
+    QString title;
+    QStringList keywords;
+    QString version;
+    QString revision;
+    QString feedUrl;
+    QString iconPath;
+    QUrl indexFileUrl;
+    bool javaScriptEnabled = false;
+
+    // Empty unless the docset database has been opened.
+    int type = 0;
+    QMap<QString, QString> symbolStrings;
+    QMap<QString, int> symbolCounts;
+
+    bool isUpToDate() const;
+
+    /// Returns size and modification time of docSet.dsidx, meta.json and Info.plist.
+    static QVector<qint64> fileStamps(const QString &docsetPath);
+
+    /// Returns snapshots keyed by docset path, or nothing if the file is missing or outdated.
+    static QHash<QString, DocsetSnapshot> load(const QString &fileName);
+    static bool save(const QString &fileName, const QList<DocsetSnapshot> &snapshots);
+};
+
+} // namespace Registry
+} // namespace Zeal
+
+QDataStream &operator<<(QDataStream &out, const Zeal::Registry::DocsetSnapshot &snapshot);
+QDataStream &operator>>(QDataStream &in, Zeal::Registry::DocsetSnapshot &snapshot);
+
+#endif // ZEAL_REGISTRY_DOCSETSNAPSHOT_H
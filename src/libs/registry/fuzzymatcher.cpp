@@ -0,0 +1,286 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Copyright (C) 2013-2014 Jerzy Kozera
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "fuzzymatcher.h"
+
+#include <QtGlobal>
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+using namespace Zeal::Registry;
+
+namespace {
+
+int lastIndexOf(const char *str, int length, char c)
+{
+    for (int i = length - 1; i >= 0; --i) {
+        if (str[i] == c)
+            return i;
+    }
+
+    return -1;
+}
+
+/*!
+ * \internal
+ * \brief Greedily matches the rest of the needle after its first character is found.
+ * \param base Start of the haystack part considered by the original recursion level.
+ * \param first Position of the first needle character.
+ * \param last Set to the position of the last needle character.
+ *
+ * Group and distance limits are applied exactly as in the original matcher, which
+ * counts a gap between \a base and \a first as a group.
+ */
+bool matchGreedy(const char *needle, int needleLength,
+                 const char *haystack, int haystackLength,
+                 int base, int first, int *last)
+{
+    int groupCount = first > base ? 1 : 0;
+
+    int j = first + 1;
+    for (int i = 1; i < needleLength; ++i) {
+        bool found = false;
+        bool firstMismatch = true;
+        int distance = 0;
+
+        while (j < haystackLength) {
+            if (needle[i] == haystack[j++]) {
+                found = true;
+                break;
+            }
+
+            if (firstMismatch) {
+                if (++groupCount >= FuzzyMatcher::MaxGroupCount)
+                    return false;
+
+                firstMismatch = false;
+            }
+
+            if (++distance >= FuzzyMatcher::MaxDistance)
+                return false;
+        }
+
+        if (!found)
+            return false;
+    }
+
+    *last = j - 1;
+    return true;
+}
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher(Mode mode)
+    : m_mode(mode)
+{
+}
+
+FuzzyMatcher::Mode FuzzyMatcher::mode() const
+{
+    return m_mode;
+}
+
+bool FuzzyMatcher::match(const char *needle, int needleLength,
+                         const char *haystack, int haystackLength,
+                         int *start, int *length) const
+{
+    if (needleLength == 0 || needleLength > haystackLength)
+        return false;
+
+    switch (m_mode) {
+    case Mode::Compatible:
+        return matchCompatible(needle, needleLength, haystack, haystackLength, start, length);
+    case Mode::BestMatch:
+        return matchBest(needle, needleLength, haystack, haystackLength, start, length);
+    }
+
+    return false;
+}
+
+int FuzzyMatcher::score(const char *str, int index, int length)
+{
+    // Score between 66..99, if the match follows a dot, or starts the string.
+    if (index == 0 || str[index - 1] == '.') {
+        return qMax(66, 100 - length);
+    }
+
+    // Score between 33..66, if the match is at the end of the string.
+    if (str[index + length] == 0) {
+        return qMax(33, 67 - length);
+    }
+
+    // Score between 1..33 otherwise (match in the middle of the string).
+    return qMax(1, 34 - length);
+}
+
+/*!
+ * \internal
+ * The original matcher (based on https://github.com/bevacqua/fuzzysearch) recursed into
+ * the rest of the haystack at every occurrence of the first needle character, and then
+ * preferred the deeper match if it scored better. Scores were calculated relative to
+ * the haystack part of the calling level, so the recursion cannot be replaced with
+ * a plain search for the best match.
+ *
+ * Here the same chain of levels is evaluated from the last occurrence backwards, which
+ * needs no recursion and no memory. Each level costs at most
+ * needleLength * MaxDistance steps.
+ */
+bool FuzzyMatcher::matchCompatible(const char *needle, int needleLength,
+                                   const char *haystack, int haystackLength,
+                                   int *start, int *length) const
+{
+    bool found = false;
+    int resultStart = -1;
+    int resultLength = -1;
+
+    int first = lastIndexOf(haystack, haystackLength, needle[0]);
+    while (first != -1) {
+        const int previous = lastIndexOf(haystack, first, needle[0]);
+        const int base = previous + 1;
+
+        // Score of the match from a deeper level, as seen by this one.
+        const int recursiveScore = found ? score(haystack + base, resultStart, resultLength) : -1;
+
+        int last;
+        if (matchGreedy(needle, needleLength, haystack, haystackLength, base, first, &last)) {
+            const int levelStart = first - base + 1;
+            const int levelLength = last - first + 1;
+
+            if (recursiveScore <= score(haystack + base, levelStart, levelLength)) {
+                resultStart = levelStart;
+                resultLength = levelLength;
+                found = true;
+            }
+        }
+
+        first = previous;
+    }
+
+    if (found) {
+        *start = resultStart;
+        *length = resultLength;
+    }
+
+    return found;
+}
+
+/*!
+ * \internal
+ * Dynamic programming over needle characters. For every haystack position and number
+ * of gaps used so far, it keeps the latest possible start of a match ending there, and
+ * the latest start following a dot, since these are the only candidates for the best
+ * score. Only two rows are kept, so memory is linear in the haystack length.
+ *
+ * Haystacks, which do not contain the needle as a subsequence, are rejected in linear
+ * time, and the rest stops at the first needle character that cannot be reached.
+ */
+bool FuzzyMatcher::matchBest(const char *needle, int needleLength,
+                             const char *haystack, int haystackLength,
+                             int *start, int *length) const
+{
+    static const int GapCount = MaxGroupCount; // Zero, one or two gaps.
+
+    for (int i = 0, j = 0; i < needleLength; ++i, ++j) {
+        while (j < haystackLength && haystack[j] != needle[i])
+            ++j;
+
+        if (j == haystackLength)
+            return false;
+    }
+
+    // Layout: [row][gaps][position], for latest starts and latest boundary starts.
+    const int rowSize = GapCount * haystackLength;
+    QVarLengthArray<int, 4096> buffer(4 * rowSize);
+    int *starts[2] = {buffer.data(), buffer.data() + rowSize};
+    int *boundaryStarts[2] = {buffer.data() + 2 * rowSize, buffer.data() + 3 * rowSize};
+
+    std::fill(buffer.begin(), buffer.end(), -1);
+
+    for (int j = 0; j < haystackLength; ++j) {
+        if (haystack[j] != needle[0])
+            continue;
+
+        starts[0][j] = j;
+        if (j == 0 || haystack[j - 1] == '.')
+            boundaryStarts[0][j] = j;
+    }
+
+    for (int i = 1; i < needleLength; ++i) {
+        const int *prevStarts = starts[(i - 1) % 2];
+        const int *prevBoundaryStarts = boundaryStarts[(i - 1) % 2];
+        int *curStarts = starts[i % 2];
+        int *curBoundaryStarts = boundaryStarts[i % 2];
+
+        std::fill(curStarts, curStarts + rowSize, -1);
+        std::fill(curBoundaryStarts, curBoundaryStarts + rowSize, -1);
+
+        bool isReachable = false;
+        for (int j = i; j < haystackLength; ++j) {
+            if (haystack[j] != needle[i])
+                continue;
+
+            for (int distance = 0; distance < MaxDistance; ++distance) {
+                const int prev = j - 1 - distance;
+                if (prev < 0)
+                    break;
+
+                const int gapIncrement = distance > 0 ? 1 : 0;
+                for (int gaps = 0; gaps + gapIncrement < GapCount; ++gaps) {
+                    const int from = gaps * haystackLength + prev;
+                    const int to = (gaps + gapIncrement) * haystackLength + j;
+                    curStarts[to] = qMax(curStarts[to], prevStarts[from]);
+                    curBoundaryStarts[to] = qMax(curBoundaryStarts[to], prevBoundaryStarts[from]);
+                    isReachable = isReachable || curStarts[to] != -1;
+                }
+            }
+        }
+
+        if (!isReachable)
+            return false;
+    }
+
+    const int *lastStarts = starts[(needleLength - 1) % 2];
+    const int *lastBoundaryStarts = boundaryStarts[(needleLength - 1) % 2];
+
+    int bestScore = 0;
+    for (int gaps = 0; gaps < GapCount; ++gaps) {
+        for (int j = 0; j < haystackLength; ++j) {
+            for (const int candidate : {lastStarts[gaps * haystackLength + j],
+                                        lastBoundaryStarts[gaps * haystackLength + j]}) {
+                if (candidate == -1)
+                    continue;
+
+                const int candidateLength = j - candidate + 1;
+                const int candidateScore = score(haystack, candidate, candidateLength);
+                if (candidateScore > bestScore) {
+                    bestScore = candidateScore;
+                    *start = candidate;
+                    *length = candidateLength;
+                }
+            }
+        }
+    }
+
+    return bestScore > 0;
+}
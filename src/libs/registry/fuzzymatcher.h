@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef ZEAL_REGISTRY_FUZZYMATCHER_H
+#define ZEAL_REGISTRY_FUZZYMATCHER_H
+
+namespace Zeal {
+namespace Registry {
+
+/**
+ * @short Finds needle characters in a haystack in order, allowing small gaps.
+ *
+ * A match may have at most MaxGroupCount - 1 gaps, and each gap must be
+ * shorter than MaxDistance characters. Matching is iterative and takes
+ * O(needle * haystack) time in the worst case, using constant memory in the
+ * compatible mode and O(haystack) memory in the best match mode.
+ */
+class FuzzyMatcher final
+{
+public:
+    enum class Mode {
+        /// Same results as the original recursive implementation, including
+        /// its quirks: the reported start is one past the first matched
+        /// character, and the leading gap counts towards the group limit.
+        Compatible,
+        /// Finds the match with the highest score().
+        BestMatch
+    };
+
+    static const int MaxDistance = 8;
+    static const int MaxGroupCount = 3;
+
+    explicit FuzzyMatcher(Mode mode = Mode::Compatible);
+
+    Mode mode() const;
+
+    /// Returns false if there is no match, otherwise sets \a start and \a length.
+    /// \a haystack must be followed by two NUL bytes.
+    bool match(const char *needle, int needleLength,
+               const char *haystack, int haystackLength,
+               int *start, int *length) const;
+
+    /// Returns score between 1 and 100 based on a match position in \a str.
+    static int score(const char *str, int index, int length);
+
+private:
+    bool matchCompatible(const char *needle, int needleLength,
+                         const char *haystack, int haystackLength,
+                         int *start, int *length) const;
+    bool matchBest(const char *needle, int needleLength,
+                   const char *haystack, int haystackLength,
+                   int *start, int *length) const;
+
+    Mode m_mode;
+};
+
+} // namespace Registry
+} // namespace Zeal
+
+#endif // ZEAL_REGISTRY_FUZZYMATCHER_H
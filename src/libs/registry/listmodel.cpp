@@ -27,6 +27,10 @@
 #include "docsetregistry.h"
 #include "itemdatarole.h"
 
+#include <QFutureWatcher>
+
+#include <QtConcurrent>
+
 #include <iterator>
 
 using namespace Zeal::Registry;
@@ -173,7 +177,7 @@ int ListModel::rowCount(const QModelIndex &parent) const
     case Level::RootLevel:
         return static_cast<int>(m_docsetItems.size());
     case Level::DocsetLevel:
-        return itemInRow(parent.row())->docset->symbolCounts().count();
+        return itemInRow(parent.row())->groups.size();
     case Level::GroupLevel: {
         auto docsetItem = static_cast<DocsetItem *>(parent.internalPointer());
         return docsetItem->docset->symbolCount(docsetItem->groups.at(parent.row())->symbolType);
@@ -183,22 +187,78 @@ int ListModel::rowCount(const QModelIndex &parent) const
     }
 }
 
-void ListModel::addDocset(const QString &name)
+bool ListModel::hasChildren(const QModelIndex &parent) const
 {
-    const int row = std::distance(m_docsetItems.begin(), m_docsetItems.upper_bound(name));
-    beginInsertRows(QModelIndex(), row, row);
+    // Avoid opening the docset just to draw the expand indicator.
+    if (indexLevel(parent) == Level::DocsetLevel && parent.column() == 0
+            && !itemInRow(parent.row())->isPopulated) {
+        return true;
+    }
 
-    auto docsetItem = new DocsetItem();
-    docsetItem->docset = m_docsetRegistry->docset(name);
+    return QAbstractItemModel::hasChildren(parent);
+}
+
+bool ListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return indexLevel(parent) == Level::DocsetLevel && parent.column() == 0
+            && !itemInRow(parent.row())->isPopulated;
+}
+
+void ListModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    DocsetItem *docsetItem = itemInRow(parent.row());
+    docsetItem->isPopulated = true;
+
+    // Opening the database may take a while, or wait for a search that is opening it,
+    // so the view is not blocked. Symbols of the groups are then read from the open database.
+    const Docset *docset = docsetItem->docset;
+    docsetItem->symbolTypesFuture = QtConcurrent::run([docset] {
+        docset->ensureDatabase();
+        return docset->symbolCounts().keys();
+    });
+
+    const QString name = docset->name();
+    auto watcher = new QFutureWatcher<QStringList>();
+    connect(watcher, &QFutureWatcher<QStringList>::finished, watcher, [this, watcher, name, docset] {
+        watcher->deleteLater();
+        addGroups(name, docset, watcher->result());
+    });
+    watcher->setFuture(docsetItem->symbolTypesFuture);
+}
 
-    const auto keys = docsetItem->docset->symbolCounts().keys();
-    for (const QString &symbolType : keys) {
+// The docset may have been removed while its symbol types were read, then they are ignored.
+void ListModel::addGroups(const QString &name, const Docset *docset, const QStringList &symbolTypes)
+{
+    const auto it = m_docsetItems.find(name);
+    if (it == m_docsetItems.end() || it->second->docset != docset || symbolTypes.isEmpty())
+        return;
+
+    DocsetItem *docsetItem = it->second;
+    const int row = static_cast<int>(std::distance(m_docsetItems.begin(), it));
+
+    beginInsertRows(createIndex(row, 0), 0, symbolTypes.size() - 1);
+
+    for (const QString &symbolType : symbolTypes) {
         auto groupItem = new GroupItem();
         groupItem->docsetItem = docsetItem;
         groupItem->symbolType = symbolType;
         docsetItem->groups.append(groupItem);
     }
 
+    endInsertRows();
+}
+
+void ListModel::addDocset(const QString &name)
+{
+    const int row = std::distance(m_docsetItems.begin(), m_docsetItems.upper_bound(name));
+    beginInsertRows(QModelIndex(), row, row);
+
+    auto docsetItem = new DocsetItem();
+    docsetItem->docset = m_docsetRegistry->docset(name);
+
     m_docsetItems.insert({name, docsetItem});
 
     endInsertRows();
@@ -212,6 +272,9 @@ void ListModel::removeDocset(const QString &name)
         return;
     }
 
+    // The docset is deleted once it has been removed.
+    it->second->symbolTypesFuture.waitForFinished();
+
     const int row = std::distance(m_docsetItems.begin(), it);
     beginRemoveRows(QModelIndex(), row, row);
 
@@ -27,6 +27,8 @@
 #include <util/caseinsensitivemap.h>
 
 #include <QAbstractItemModel>
+#include <QFuture>
+#include <QStringList>
 
 namespace Zeal {
 namespace Registry {
@@ -46,6 +48,12 @@ public:
     QModelIndex parent(const QModelIndex &child) const override;
     int columnCount(const QModelIndex &parent) const override;
     int rowCount(const QModelIndex &parent) const override;
+    bool hasChildren(const QModelIndex &parent) const override;
+
+    // Groups of a docset are added when it is expanded, once its database is opened
+    // in the background.
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
 
 private slots:
     void addDocset(const QString &name);
@@ -79,9 +87,12 @@ private:
         const Level level = Level::DocsetLevel;
         Docset *docset = nullptr;
         QList<GroupItem *> groups;
+        bool isPopulated = false;
+        QFuture<QStringList> symbolTypesFuture; // Uses the docset until finished.
     };
 
     inline DocsetItem *itemInRow(int row) const;
+    void addGroups(const QString &name, const Docset *docset, const QStringList &symbolTypes);
 
     Util::CaseInsensitiveMap<DocsetItem *> m_docsetItems;
 };
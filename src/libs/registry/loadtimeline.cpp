@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#include "loadtimeline.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+using namespace Zeal::Registry;
+
+LoadTimeline::Scope::Scope(LoadTimeline *timeline, const char *stage, const QString &docsetPath)
+    : m_timeline(timeline)
+    , m_stage(stage)
+    , m_docsetPath(docsetPath)
+    , m_start(timeline != nullptr ? timeline->elapsed() : 0)
+{
+}
+
+LoadTimeline::Scope::~Scope()
+{
+    if (m_timeline == nullptr)
+        return;
+
+    m_timeline->record(m_stage, m_docsetPath, m_start, m_timeline->elapsed() - m_start);
+}
+
+LoadTimeline::LoadTimeline()
+{
+    m_timer.start();
+}
+
+qint64 LoadTimeline::elapsed() const
+{
+    return m_timer.nsecsElapsed() / 1000;
+}
+
+void LoadTimeline::record(const char *stage, const QString &docsetPath, qint64 start, qint64 duration)
+{
+    const auto threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker locker(&m_mutex);
+    m_events.append({stage, docsetPath, start, duration, threadId});
+}
+
+QByteArray LoadTimeline::toChromeTrace() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+
+    QMutexLocker locker(&m_mutex);
+    for (const Event &event : m_events) {
+        const QString docsetName = QFileInfo(event.docsetPath).fileName();
+
+        // Complete events, see the Trace Event Format specification.
+        traceEvents.append(QJsonObject{
+                               {QStringLiteral("name"), QString::fromLatin1(event.stage)},
+                               {QStringLiteral("cat"), QStringLiteral("docset")},
+                               {QStringLiteral("ph"), QStringLiteral("X")},
+                               {QStringLiteral("ts"), event.start},
+                               {QStringLiteral("dur"), event.duration},
+                               {QStringLiteral("pid"), pid},
+                               {QStringLiteral("tid"), static_cast<qint64>(event.threadId)},
+                               {QStringLiteral("args"), QJsonObject{
+                                    {QStringLiteral("docset"), docsetName},
+                                    {QStringLiteral("path"), event.docsetPath}
+                                }}
+                           });
+    }
+
+    const QJsonObject trace = {
+        {QStringLiteral("traceEvents"), traceEvents},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")}
+    };
+
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+bool LoadTimeline::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Cannot save docset load timeline to '%s': %s",
+                 qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    return file.write(toChromeTrace()) != -1;
+}
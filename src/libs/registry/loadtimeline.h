@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#ifndef ZEAL_REGISTRY_LOADTIMELINE_H
+#define ZEAL_REGISTRY_LOADTIMELINE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace Zeal {
+namespace Registry {
+
+/**
+ * @short Records how long each stage of loading docsets takes.
+ *
+ * Events can be recorded from any thread. The timeline is saved in the Chrome
+ * trace event format, which can be opened in chrome://tracing or Perfetto.
+ */
+class LoadTimeline final
+{
+    Q_DISABLE_COPY(LoadTimeline)
+public:
+    /// Records the enclosing scope, does nothing if the timeline is null.
+    class Scope final
+    {
+        Q_DISABLE_COPY(Scope)
+    public:
+        Scope(LoadTimeline *timeline, const char *stage, const QString &docsetPath);
+        ~Scope();
+
+    private:
+        LoadTimeline *m_timeline;
+        const char *m_stage;
+        QString m_docsetPath;
+        qint64 m_start;
+    };
+
+    LoadTimeline();
+
+    /// Times are in microseconds since the timeline was created.
+    qint64 elapsed() const;
+    void record(const char *stage, const QString &docsetPath, qint64 start, qint64 duration);
+
+    QByteArray toChromeTrace() const;
+    bool save(const QString &fileName) const;
+
+private:
+    struct Event {
+        const char *stage;
+        QString docsetPath;
+        qint64 start;
+        qint64 duration;
+        quint64 threadId;
+    };
+
+    QElapsedTimer m_timer;
+
+    mutable QMutex m_mutex;
+    QVector<Event> m_events;
+};
+
+} // namespace Registry
+} // namespace Zeal
+
+#endif // ZEAL_REGISTRY_LOADTIMELINE_H
@@ -0,0 +1,544 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Copyright (C) 2013-2014 Jerzy Kozera
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "scorer.h"
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZEAL_SCORER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled with a function level target attribute, and only called if supported.
+#if defined(ZEAL_SCORER_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ZEAL_SCORER_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace Zeal::Registry;
+
+namespace {
+
+inline char normalizeChar(char c, char prev)
+{
+    if ((prev == ':' && c == ':') // C++ (::)
+            || c == '/' || c == '_' || c == ' ') { // Go, some Guides
+        return '.';
+    }
+
+    if (c >= 'A' && c <= 'Z')
+        return c + 32;
+
+    return c;
+}
+
+#ifndef ZEAL_SCORER_SSE2
+void normalizeScalar(const char *str, int length, char *out)
+{
+    for (int i = 0; i < length; ++i)
+        out[i] = normalizeChar(str[i], i > 0 ? str[i - 1] : 0);
+}
+#endif
+
+// ASCII letters are folded, and all separators share a bit, so that raw and normalized
+// strings have the same signature, and names with other scope separators are not rejected.
+inline int signatureBit(uchar c)
+{
+    if (c >= 'a' && c <= 'z')
+        return c - 'a';
+
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+
+    if (c >= '0' && c <= '9')
+        return 26 + (c - '0');
+
+    if (Scorer::isScopeSeparator(static_cast<char>(c)) || c == '_' || c == ' ')
+        return 36;
+
+    return 37 + c % 27;
+}
+
+#ifndef ZEAL_SCORER_SSE2
+int filterSignaturesScalar(const quint64 *signatures, int count, quint64 required, int *offsets)
+{
+    int passedCount = 0;
+    for (int i = 0; i < count; ++i) {
+        if ((signatures[i] & required) == required)
+            offsets[passedCount++] = i;
+    }
+
+    return passedCount;
+}
+#endif
+
+int indexOfCharScalar(const char *haystack, int haystackLength, char c)
+{
+    auto p = static_cast<const char *>(std::memchr(haystack, c, static_cast<size_t>(haystackLength)));
+    return p != nullptr ? static_cast<int>(p - haystack) : -1;
+}
+
+int indexOfScalar(const char *haystack, int haystackLength, const char *needle, int needleLength)
+{
+    for (int i = 0; i + needleLength <= haystackLength; ++i) {
+        if (haystack[i] == needle[0]
+                && std::memcmp(haystack + i + 1, needle + 1, static_cast<size_t>(needleLength - 1)) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef ZEAL_SCORER_SSE2
+void normalizeSse2(const char *str, int length, char *out)
+{
+    if (length <= 0)
+        return;
+
+    out[0] = normalizeChar(str[0], 0);
+
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i dot = _mm_set1_epi8('.');
+    // Shifts 'A'..'Z' to the bottom of the signed range for a single comparison.
+    const __m128i upperShift = _mm_set1_epi8(static_cast<char>('A' + 128));
+    const __m128i upperBound = _mm_set1_epi8(-128 + 26);
+    const __m128i caseBit = _mm_set1_epi8(32);
+
+    int i = 1;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i - 1));
+
+        const __m128i separator
+                = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(cur, colon), _mm_cmpeq_epi8(prev, colon)),
+                               _mm_or_si128(_mm_cmpeq_epi8(cur, slash),
+                                            _mm_or_si128(_mm_cmpeq_epi8(cur, underscore),
+                                                         _mm_cmpeq_epi8(cur, space))));
+        const __m128i upper = _mm_cmplt_epi8(_mm_sub_epi8(cur, upperShift), upperBound);
+        const __m128i folded = _mm_add_epi8(cur, _mm_and_si128(upper, caseBit));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_or_si128(_mm_and_si128(separator, dot),
+                                      _mm_andnot_si128(separator, folded)));
+    }
+
+    for (; i < length; ++i)
+        out[i] = normalizeChar(str[i], str[i - 1]);
+}
+
+int filterSignaturesSse2(const quint64 *signatures, int count, quint64 required, int *offsets)
+{
+    const __m128i mask = _mm_set1_epi64x(static_cast<qint64>(required));
+
+    int passedCount = 0;
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(signatures + i));
+        // Without 64-bit comparisons, both halves of a signature must be equal.
+        const int equal = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(block, mask), mask));
+
+        if ((equal & 0x00ff) == 0x00ff)
+            offsets[passedCount++] = i;
+        if ((equal & 0xff00) == 0xff00)
+            offsets[passedCount++] = i + 1;
+    }
+
+    for (; i < count; ++i) {
+        if ((signatures[i] & required) == required)
+            offsets[passedCount++] = i;
+    }
+
+    return passedCount;
+}
+
+int indexOfCharSse2(const char *haystack, int haystackLength, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+
+    int i = 0;
+    for (; i + 16 <= haystackLength; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask != 0)
+            return i + static_cast<int>(qCountTrailingZeroBits(static_cast<quint32>(mask)));
+    }
+
+    const int index = indexOfCharScalar(haystack + i, haystackLength - i, c);
+    return index != -1 ? i + index : -1;
+}
+
+// Compares the first and the last needle characters for 16 positions at once,
+// and only verifies the remaining characters for candidates.
+int indexOfSse2(const char *haystack, int haystackLength, const char *needle, int needleLength)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+
+    int i = 0;
+    for (; i + needleLength - 1 + 16 <= haystackLength; i += 16) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + needleLength - 1));
+
+        auto mask = static_cast<quint32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                                         _mm_cmpeq_epi8(blockLast, last))));
+        while (mask != 0) {
+            const int index = i + static_cast<int>(qCountTrailingZeroBits(mask));
+            if (std::memcmp(haystack + index + 1, needle + 1, static_cast<size_t>(needleLength - 2)) == 0)
+                return index;
+            mask &= mask - 1;
+        }
+    }
+
+    const int index = indexOfScalar(haystack + i, haystackLength - i, needle, needleLength);
+    return index != -1 ? i + index : -1;
+}
+#endif // ZEAL_SCORER_SSE2
+
+#ifdef ZEAL_SCORER_AVX2
+__attribute__((target("avx2")))
+void normalizeAvx2(const char *str, int length, char *out)
+{
+    if (length <= 0)
+        return;
+
+    out[0] = normalizeChar(str[0], 0);
+
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i underscore = _mm256_set1_epi8('_');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i dot = _mm256_set1_epi8('.');
+    const __m256i upperShift = _mm256_set1_epi8(static_cast<char>('A' + 128));
+    const __m256i upperBound = _mm256_set1_epi8(-128 + 26);
+    const __m256i caseBit = _mm256_set1_epi8(32);
+
+    int i = 1;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + i));
+        const __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + i - 1));
+
+        const __m256i separator
+                = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(cur, colon),
+                                                   _mm256_cmpeq_epi8(prev, colon)),
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(cur, slash),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(cur, underscore),
+                                                                  _mm256_cmpeq_epi8(cur, space))));
+        const __m256i upper = _mm256_cmpgt_epi8(upperBound, _mm256_sub_epi8(cur, upperShift));
+        const __m256i folded = _mm256_add_epi8(cur, _mm256_and_si256(upper, caseBit));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                            _mm256_blendv_epi8(folded, dot, separator));
+    }
+
+    for (; i < length; ++i)
+        out[i] = normalizeChar(str[i], str[i - 1]);
+}
+
+__attribute__((target("avx2")))
+int filterSignaturesAvx2(const quint64 *signatures, int count, quint64 required, int *offsets)
+{
+    const __m256i mask = _mm256_set1_epi64x(static_cast<qint64>(required));
+
+    int passedCount = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(signatures + i));
+        const __m256i equal = _mm256_cmpeq_epi64(_mm256_and_si256(block, mask), mask);
+
+        auto passed = static_cast<quint32>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)));
+        while (passed != 0) {
+            offsets[passedCount++] = i + static_cast<int>(qCountTrailingZeroBits(passed));
+            passed &= passed - 1;
+        }
+    }
+
+    for (; i < count; ++i) {
+        if ((signatures[i] & required) == required)
+            offsets[passedCount++] = i;
+    }
+
+    return passedCount;
+}
+
+__attribute__((target("avx2")))
+int indexOfCharAvx2(const char *haystack, int haystackLength, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+
+    int i = 0;
+    for (; i + 32 <= haystackLength; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        const int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+        if (mask != 0)
+            return i + static_cast<int>(qCountTrailingZeroBits(static_cast<quint32>(mask)));
+    }
+
+    const int index = indexOfCharSse2(haystack + i, haystackLength - i, c);
+    return index != -1 ? i + index : -1;
+}
+
+__attribute__((target("avx2")))
+int indexOfAvx2(const char *haystack, int haystackLength, const char *needle, int needleLength)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+
+    int i = 0;
+    for (; i + needleLength - 1 + 32 <= haystackLength; i += 32) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        const __m256i blockLast
+                = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + needleLength - 1));
+
+        auto mask = static_cast<quint32>(_mm256_movemask_epi8(
+                                             _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                              _mm256_cmpeq_epi8(blockLast, last))));
+        while (mask != 0) {
+            const int index = i + static_cast<int>(qCountTrailingZeroBits(mask));
+            if (std::memcmp(haystack + index + 1, needle + 1, static_cast<size_t>(needleLength - 2)) == 0)
+                return index;
+            mask &= mask - 1;
+        }
+    }
+
+    const int index = indexOfSse2(haystack + i, haystackLength - i, needle, needleLength);
+    return index != -1 ? i + index : -1;
+}
+#endif // ZEAL_SCORER_AVX2
+
+struct Implementation
+{
+    void (*normalize)(const char *, int, char *);
+    int (*indexOfChar)(const char *, int, char);
+    int (*indexOf)(const char *, int, const char *, int);
+    int (*filterSignatures)(const quint64 *, int, quint64, int *);
+};
+
+Implementation selectImplementation()
+{
+#ifdef ZEAL_SCORER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {normalizeAvx2, indexOfCharAvx2, indexOfAvx2, filterSignaturesAvx2};
+#endif
+
+#ifdef ZEAL_SCORER_SSE2
+    return {normalizeSse2, indexOfCharSse2, indexOfSse2, filterSignaturesSse2};
+#else
+    return {normalizeScalar, indexOfCharScalar, indexOfScalar, filterSignaturesScalar};
+#endif
+}
+
+const Implementation &implementation()
+{
+    static const Implementation impl = selectImplementation();
+    return impl;
+}
+
+// Ported from DevDocs (https://github.com/Thibaut/devdocs), see app/searcher.coffee.
+int scoreExact(int matchIndex, int matchLen, const char *value, int valueLen)
+{
+    static const char DOT = '.';
+
+    int score = 100;
+
+    // Remove one point for each unmatched character.
+    score -= (valueLen - matchLen);
+
+    if (matchIndex > 0) {
+        if (value[matchIndex - 1] == DOT) {
+            // If the character preceding the query is a dot, assign the same
+            // score as if the query was found at the beginning of the string,
+            // minus one.
+            score += matchIndex - 1;
+        } else if (matchLen == 1) {
+            // Don't match a single-character query unless it's found at the
+            // beginning of the string or is preceded by a dot.
+            return 0;
+        } else {
+            // (1) Remove one point for each unmatched character up to
+            //     the nearest preceding dot or the beginning of the
+            //     string.
+            // (2) Remove one point for each unmatched character
+            //     following the query.
+            int i = matchIndex - 2;
+            while (i >= 0 && value[i] != DOT)
+                --i;
+
+            score -= (matchIndex - i)                      // (1)
+                    + (valueLen - matchLen - matchIndex);  // (2)
+        }
+
+        // Remove one point for each dot preceding the query, except for the
+        // one immediately before the query.
+        for (int i = matchIndex - 2; i >= 0; --i) {
+            if (value[i] == DOT)
+                --score;
+        }
+    }
+
+    // Remove five points for each dot following the query.
+    for (int i = valueLen - matchLen - matchIndex - 1; i >= 0; --i) {
+        if (value[matchIndex + matchLen + i] == DOT)
+            score -= 5;
+    }
+
+    return qMax(1, score);
+}
+
+} // namespace
+
+Scorer::Scorer(const QByteArray &query, FuzzyMatcher::Mode mode)
+    : m_needle(normalize(query))
+    , m_matcher(mode)
+{
+}
+
+QByteArray Scorer::needle() const
+{
+    return m_needle;
+}
+
+int Scorer::score(const char *haystack, int length) const
+{
+    const char *needle = m_needle.constData();
+    const int needleLength = m_needle.size();
+
+    // Neither exact nor fuzzy match can be shorter than the needle.
+    if (needleLength == 0 || length < needleLength)
+        return 0;
+
+    const int exactIndex = indexOf(haystack, length, needle, needleLength);
+    if (exactIndex != -1) {
+        // +100 to make sure exact matches are always on top.
+        return scoreExact(exactIndex, needleLength, haystack, length) + 100;
+    }
+
+    int matchIndex;
+    int matchLength;
+    if (!m_matcher.match(needle, needleLength, haystack, length, &matchIndex, &matchLength)) {
+        // no match
+        return 0;
+    }
+
+    int score = FuzzyMatcher::score(haystack, matchIndex, matchLength);
+
+    int indexOfLastDot;
+    for (indexOfLastDot = length - 1; indexOfLastDot >= 0; --indexOfLastDot) {
+        if (haystack[indexOfLastDot] == '.')
+            break;
+    }
+
+    if (indexOfLastDot != -1
+            && m_matcher.match(needle, needleLength,
+                               haystack + indexOfLastDot + 1, length - (indexOfLastDot + 1),
+                               &matchIndex, &matchLength)) {
+        score = qMax(score, FuzzyMatcher::score(haystack + indexOfLastDot + 1,
+                                                matchIndex, matchLength));
+    }
+
+    return score;
+}
+
+void Scorer::score(const char *names, const int *offsets, int count, int *scores) const
+{
+    std::fill(scores, scores + count, 0);
+
+    if (m_needle.isEmpty() || count <= 0)
+        return;
+
+    // Any match contains the first needle character, so instead of looking at every name,
+    // jump between occurrences of that character in the whole block.
+    const char first = m_needle.at(0);
+    const int end = offsets[count];
+
+    int row = 0;
+    int position = offsets[0];
+    while (row < count) {
+        const int index = indexOf(names + position, end - position, first);
+        if (index == -1)
+            break;
+
+        row = static_cast<int>(std::upper_bound(offsets + row, offsets + count + 1, position + index)
+                               - offsets) - 1;
+        scores[row] = score(names + offsets[row], offsets[row + 1] - offsets[row] - 2);
+
+        position = offsets[++row];
+    }
+}
+
+quint64 Scorer::signature(const char *str, int length)
+{
+    quint64 signature = 0;
+    for (int i = 0; i < length; ++i)
+        signature |= Q_UINT64_C(1) << signatureBit(static_cast<uchar>(str[i]));
+
+    return signature;
+}
+
+int Scorer::filterSignatures(const quint64 *signatures, int count, quint64 required, int *offsets)
+{
+    return implementation().filterSignatures(signatures, count, required, offsets);
+}
+
+void Scorer::normalize(const char *str, int length, char *out)
+{
+    implementation().normalize(str, length, out);
+}
+
+QByteArray Scorer::normalize(const QByteArray &str)
+{
+    QByteArray result(str.size(), Qt::Uninitialized);
+    normalize(str.constData(), str.size(), result.data());
+    return result;
+}
+
+int Scorer::indexOf(const char *haystack, int haystackLength, const char *needle, int needleLength)
+{
+    if (needleLength == 0)
+        return 0;
+
+    if (needleLength > haystackLength)
+        return -1;
+
+    if (needleLength == 1)
+        return indexOf(haystack, haystackLength, needle[0]);
+
+    return implementation().indexOf(haystack, haystackLength, needle, needleLength);
+}
+
+int Scorer::indexOf(const char *haystack, int haystackLength, char c)
+{
+    if (haystackLength <= 0)
+        return -1;
+
+    return implementation().indexOfChar(haystack, haystackLength, c);
+}
@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef ZEAL_REGISTRY_SCORER_H
+#define ZEAL_REGISTRY_SCORER_H
+
+#include "fuzzymatcher.h"
+
+#include <QByteArray>
+
+namespace Zeal {
+namespace Registry {
+
+/**
+ * @short Scores symbol names against a search query.
+ *
+ * Both the query and the names are expected in the normalized form produced
+ * by normalize(): ASCII letters are lowercased, and separators ('::', '/',
+ * '_' and ' ') are replaced with dots. Normalization preserves string length,
+ * so a normalized copy of a name arena shares offsets with the original.
+ *
+ * Hot loops are vectorized with SSE2 or AVX2 when the CPU supports them, the
+ * implementation is selected at runtime.
+ */
+class Scorer final
+{
+public:
+    explicit Scorer(const QByteArray &query,
+                    FuzzyMatcher::Mode mode = FuzzyMatcher::Mode::Compatible);
+
+    QByteArray needle() const;
+
+    /// Returns score for a single normalized name, 0 if there is no match.
+    /// \a haystack must be followed by two NUL bytes.
+    int score(const char *haystack, int length) const;
+
+    /// Scores \a count names stored back to back in \a names, each followed by two NUL bytes.
+    /// Name \c i starts at \c offsets[i], so \a offsets must have \a count + 1 items.
+    void score(const char *names, const int *offsets, int count, int *scores) const;
+
+    /// Returns a bit set of character classes in \a str. A name can only match a needle,
+    /// if the signature of the name contains all bits of the needle signature. Raw and
+    /// normalized forms of a string have the same signature.
+    static quint64 signature(const char *str, int length);
+
+    /// Writes offsets of \a signatures containing all bits of \a required into \a offsets,
+    /// which must have room for \a count items. Returns the number of written offsets.
+    static int filterSignatures(const quint64 *signatures, int count, quint64 required, int *offsets);
+
+    /// Returns true if \a c separates a scope from its members, e.g. in "std::vector",
+    /// "os.path", "net/http" or "String#split". Queries match any of them interchangeably.
+    static inline bool isScopeSeparator(char c)
+    {
+        return c == '.' || c == ':' || c == '/' || c == '#';
+    }
+
+    /// Writes normalized \a str into \a out, which must not overlap with \a str.
+    static void normalize(const char *str, int length, char *out);
+    static QByteArray normalize(const QByteArray &str);
+
+    /// Returns the index of the first occurrence of \a needle, or -1.
+    static int indexOf(const char *haystack, int haystackLength, const char *needle, int needleLength);
+    static int indexOf(const char *haystack, int haystackLength, char c);
+
+private:
+    QByteArray m_needle;
+    FuzzyMatcher m_matcher;
+};
+
+} // namespace Registry
+} // namespace Zeal
+
+#endif // ZEAL_REGISTRY_SCORER_H
@@ -37,6 +37,7 @@ SearchModel *SearchModel::clone(QObject *parent)
 {
     auto model = new SearchModel(parent);
     model->m_dataList = m_dataList;
+    model->m_hasMoreResults = m_hasMoreResults;
     return model;
 }
 
@@ -117,10 +118,88 @@ void SearchModel::removeSearchResultWithName(const QString &name)
     }
 }
 
-void SearchModel::setResults(const QList<SearchResult> &results)
+bool SearchModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_hasMoreResults;
+}
+
+void SearchModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    // Wait for appendResults() before requesting more.
+    m_hasMoreResults = false;
+    emit fetchMoreRequested();
+}
+
+void SearchModel::setResults(const QList<SearchResult> &results, bool hasMoreResults)
 {
     beginResetModel();
     m_dataList = results;
+    m_hasMoreResults = hasMoreResults;
     endResetModel();
     emit updated();
 }
+
+void SearchModel::appendResults(const QList<SearchResult> &results, bool hasMoreResults)
+{
+    m_hasMoreResults = hasMoreResults;
+
+    if (results.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), m_dataList.size(), m_dataList.size() + results.size() - 1);
+    m_dataList.append(results);
+    endInsertRows();
+    emit updated();
+}
+
+void SearchModel::startStreaming()
+{
+    // Keep current results until new ones arrive.
+    m_hasMoreResults = false;
+    m_resetPending = true;
+}
+
+void SearchModel::mergeResults(const QList<SearchResult> &results, const QVector<int> &rows,
+                               int rowCount)
+{
+    if (m_resetPending) {
+        m_resetPending = false;
+        setResults(results);
+        return;
+    }
+
+    // Insert contiguous rows at once.
+    for (int i = 0; i < results.size();) {
+        int last = i;
+        while (last + 1 < results.size() && rows.at(last + 1) == rows.at(last) + 1)
+            ++last;
+
+        beginInsertRows(QModelIndex(), rows.at(i), rows.at(last));
+        for (int j = i; j <= last; ++j)
+            m_dataList.insert(rows.at(j), results.at(j));
+        endInsertRows();
+
+        i = last + 1;
+    }
+
+    if (m_dataList.size() > rowCount) {
+        beginRemoveRows(QModelIndex(), rowCount, m_dataList.size() - 1);
+        m_dataList.erase(m_dataList.begin() + rowCount, m_dataList.end());
+        endRemoveRows();
+    }
+
+    emit updated();
+}
+
+void SearchModel::finishStreaming(bool hasMoreResults)
+{
+    if (m_resetPending) {
+        m_resetPending = false;
+        setResults();
+    }
+
+    m_hasMoreResults = hasMoreResults;
+}
@@ -27,6 +27,7 @@
 #include "searchresult.h"
 
 #include <QAbstractListModel>
+#include <QVector>
 
 namespace Zeal {
 namespace Registry {
@@ -47,14 +48,27 @@ public:
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
     void removeSearchResultWithName(const QString &name);
 
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
 public slots:
-    void setResults(const QList<SearchResult> &results = QList<SearchResult>());
+    void setResults(const QList<SearchResult> &results = QList<SearchResult>(),
+                    bool hasMoreResults = false);
+    void appendResults(const QList<SearchResult> &results, bool hasMoreResults);
+
+    // Streamed results, see DocsetRegistry::searchResultsMerged().
+    void startStreaming();
+    void mergeResults(const QList<SearchResult> &results, const QVector<int> &rows, int rowCount);
+    void finishStreaming(bool hasMoreResults);
 
 signals:
     void updated();
+    void fetchMoreRequested();
 
 private:
     QList<SearchResult> m_dataList;
+    bool m_hasMoreResults = false;
+    bool m_resetPending = false;
 };
 
 } // namespace Registry
@@ -30,6 +30,12 @@ using namespace Zeal::Registry;
 namespace {
 const char prefixSeparator = ':';
 const char keywordSeparator = ',';
+
+bool isSymbolTypePrefix(const QString &str)
+{
+    return str.compare(QLatin1String("t"), Qt::CaseInsensitive) == 0
+            || str.compare(QLatin1String("type"), Qt::CaseInsensitive) == 0;
+}
 }
 
 SearchQuery::SearchQuery(QString query, const QStringList &keywords) :
@@ -43,32 +49,57 @@ SearchQuery SearchQuery::fromString(const QString &str)
     const int sepAt = str.indexOf(prefixSeparator);
     const int next = sepAt + 1;
 
-    QString query;
-    QStringList keywords;
-    if (sepAt > 0 && (next >= str.size() || str.at(next) != prefixSeparator)) {
-        query = str.mid(next).trimmed();
+    // Filters are skipped as typed, so that the query start is known in the original string.
+    int queryStart = 0;
+    const auto skipSpaces = [&str, &queryStart] {
+        while (queryStart < str.size() && str.at(queryStart).isSpace())
+            ++queryStart;
+    };
 
+    QStringList keywords;
+    if (sepAt > 0 && (next >= str.size() || str.at(next) != prefixSeparator)
+            && !isSymbolTypePrefix(str.left(sepAt).trimmed())) {
         const QString keywordStr = str.left(sepAt).trimmed();
         keywords = keywordStr.split(keywordSeparator);
-    } else {
-        query = str.trimmed();
+        queryStart = next;
     }
 
-    return SearchQuery(query, keywords);
+    skipSpaces();
+
+    QStringList symbolTypes;
+    const int typeSepAt = str.indexOf(prefixSeparator, queryStart);
+    const int typeNext = typeSepAt + 1;
+    if (typeSepAt > queryStart && (typeNext >= str.size() || str.at(typeNext) != prefixSeparator)
+            && isSymbolTypePrefix(str.mid(queryStart, typeSepAt - queryStart))) {
+        int end = typeNext;
+        while (end < str.size() && !str.at(end).isSpace())
+            ++end;
+
+        symbolTypes = str.mid(typeNext, end - typeNext)
+                .split(keywordSeparator, QString::SkipEmptyParts);
+        queryStart = end;
+        skipSpaces();
+    }
+
+    SearchQuery searchQuery(str.mid(queryStart).trimmed(), keywords);
+    searchQuery.setSymbolTypes(symbolTypes);
+    if (!keywords.isEmpty() || !symbolTypes.isEmpty())
+        searchQuery.m_prefixSize = queryStart;
+    return searchQuery;
 }
 
 QString SearchQuery::toString() const
 {
     if (m_keywords.isEmpty()) {
-        return m_query;
+        return m_symbolTypePrefix + m_query;
     }
 
-    return m_keywordPrefix + m_query;
+    return m_keywordPrefix + m_symbolTypePrefix + m_query;
 }
 
 bool SearchQuery::isEmpty() const
 {
-    return m_query.isEmpty() && m_keywords.isEmpty();
+    return m_query.isEmpty() && m_keywords.isEmpty() && m_symbolTypes.isEmpty();
 }
 
 QStringList SearchQuery::keywords() const
@@ -83,6 +114,7 @@ void SearchQuery::setKeywords(const QStringList &list)
 
     m_keywords = list;
     m_keywordPrefix = list.join(keywordSeparator) + prefixSeparator;
+    m_prefixSize = -1;
 }
 
 bool SearchQuery::hasKeywords() const
@@ -103,7 +135,33 @@ bool SearchQuery::hasKeywords(const QStringList &keywords) const
 
 int SearchQuery::keywordPrefixSize() const
 {
-    return m_keywordPrefix.size();
+    if (m_prefixSize >= 0)
+        return m_prefixSize;
+
+    return m_keywordPrefix.size() + m_symbolTypePrefix.size();
+}
+
+QStringList SearchQuery::symbolTypes() const
+{
+    return m_symbolTypes;
+}
+
+void SearchQuery::setSymbolTypes(const QStringList &list)
+{
+    m_symbolTypes = list;
+    m_prefixSize = -1;
+
+    if (list.isEmpty()) {
+        m_symbolTypePrefix.clear();
+        return;
+    }
+
+    m_symbolTypePrefix = QStringLiteral("t:") + list.join(keywordSeparator) + QLatin1Char(' ');
+}
+
+bool SearchQuery::hasSymbolTypes() const
+{
+    return !m_symbolTypes.isEmpty();
 }
 
 QString SearchQuery::query() const
@@ -50,9 +50,18 @@ public:
     ///   ":find"             #=> docsetFilters = [], coreQuery = ":find"
     ///   "std::string"       #=> docsetFilters = [], coreQuery = "std::string"
     ///   "c++:std::string"   #=> docsetFilters = ["c++"], coreQuery = "std::string"
+    ///   "vector push"       #=> docsetFilters = [], coreQuery = "vector push"
+    ///
+    /// Whitespace separated terms of coreQuery are matched independently.
     ///
     /// Multiple docsets are supported using the ',' character:
     ///   "java,android:setTypeFa #=> docsetFilters = ["java", "android"], coreQuery = "setTypeFa"
+    ///
+    /// Symbol types can be limited with the 't:' or 'type:' prefix after the docset filter:
+    ///   "java:t:Method getInstance" #=> docsetFilters = ["java"], symbolTypes = ["Method"],
+    ///                                   coreQuery = "getInstance"
+    ///   "type:Class,Struct vector"  #=> docsetFilters = [], symbolTypes = ["Class", "Struct"],
+    ///                                   coreQuery = "vector"
 
     static SearchQuery fromString(const QString &str);
 
@@ -69,9 +78,15 @@ public:
     /// Returns true if one the query contains one of the @c keywords.
     bool hasKeywords(const QStringList &keywords) const;
 
-    /// Returns the docset filter raw size for the given query
+    /// Returns the raw size of the docset and symbol type filters for the given query,
+    /// including any whitespace, as typed if the query was parsed by fromString().
     int keywordPrefixSize() const;
 
+    /// Symbol types as typed, either canonical names or aliases used by docsets.
+    QStringList symbolTypes() const;
+    void setSymbolTypes(const QStringList &list);
+    bool hasSymbolTypes() const;
+
     QString query() const;
     void setQuery(const QString &str);
 
@@ -79,6 +94,9 @@ private:
     QString m_query;
     QStringList m_keywords;
     QString m_keywordPrefix;
+    QStringList m_symbolTypes;
+    QString m_symbolTypePrefix;
+    int m_prefixSize = -1; // Size of filters as typed, see fromString().
 };
 
 } // namespace Registry
@@ -43,12 +43,54 @@ struct SearchResult
     Docset *docset;
 
     int score;
+};
+
+/**
+ * @short A symbol matching a search query.
+ *
+ * Hits are cheap to create and sort, and are turned into SearchResult only
+ * when they are about to be displayed. Hits with equal scores are ordered by
+ * ASCII case-insensitive comparison of UTF-8 names, which mostly boils down
+ * to comparing a key made of the first 8 case-folded bytes of the name.
+ */
+struct SearchHit
+{
+    int score;
+    int index; // Symbol index in the docset.
+    quint64 sortKey;
+    const char *name; // NUL-terminated name, owned by the docset.
+
+    inline static uchar foldCase(char c)
+    {
+        return static_cast<uchar>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
 
-    inline bool operator<(const SearchResult &other) const
+    inline static quint64 makeSortKey(const char *name)
     {
-        if (score == other.score)
-            return QString::compare(name, other.name, Qt::CaseInsensitive) < 0;
-        return score > other.score;
+        quint64 key = 0;
+        for (int i = 0; i < 8; ++i) {
+            key <<= 8;
+            if (*name != 0)
+                key |= foldCase(*name++);
+        }
+
+        return key;
+    }
+
+    inline bool operator<(const SearchHit &other) const
+    {
+        if (score != other.score)
+            return score > other.score;
+
+        if (sortKey != other.sortKey)
+            return sortKey < other.sortKey;
+
+        for (const char *a = name, *b = other.name; ; ++a, ++b) {
+            const uchar ca = foldCase(*a);
+            const uchar cb = foldCase(*b);
+            if (ca != cb || ca == 0)
+                return ca < cb;
+        }
     }
 };
 
@@ -0,0 +1,884 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#include "symbolindex.h"
+
+#include "scorer.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QScopedPointer>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+using namespace Zeal::Registry;
+
+namespace {
+const char IndexMagic[8] = {'Z', 'E', 'A', 'L', 'S', 'Y', 'M', 'I'};
+// Must be increased on any change to the file layout.
+const quint32 IndexVersion = 6;
+// Files are written in the native byte order, and ignored on a mismatch.
+const quint32 ByteOrderMark = 0x01020304;
+
+const int MaxSourceStampCount = 4;
+
+const int MaxTypoNeedleLength = 64;
+
+enum Section {
+    Names,
+    NormalizedNames,
+    NameOffsets,
+    Signatures,
+    Urls,
+    PathOffsets,
+    FragmentOffsets,
+    TypeIds,
+    Types,
+    Trigrams,
+    TrigramOffsets,
+    TrigramPostings,
+    PrefixOrder,
+    ComponentOrder,
+    MemberOffsets,
+    MemberOrder,
+    Acronyms,
+    AcronymOffsets,
+    MemberAcronymOffsets,
+    AcronymOrder,
+    MemberAcronymOrder,
+    SectionCount
+};
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    qint64 sourceStamps[MaxSourceStampCount];
+    qint32 sourceStampCount;
+    qint32 count;
+    struct {
+        qint64 offset;
+        qint64 size;
+    } sections[SectionCount];
+};
+
+// Sections are aligned, so that arrays can be used directly from mapped memory.
+inline qint64 alignedOffset(qint64 offset)
+{
+    return (offset + 7) & ~static_cast<qint64>(7);
+}
+
+template<typename T>
+inline void appendValue(QByteArray &array, T value)
+{
+    array.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+inline const T *values(const QByteArray &array)
+{
+    return reinterpret_cast<const T *>(array.constData());
+}
+
+inline uchar toLowerAscii(char c)
+{
+    return static_cast<uchar>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+}
+
+// Components of normalized names are separated by dots.
+inline const char *lastComponent(const char *normalizedName)
+{
+    const char *dot = std::strrchr(normalizedName, '.');
+    return dot != nullptr ? dot + 1 : normalizedName;
+}
+
+inline bool isAsciiUpper(char c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+inline bool isAsciiDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isAsciiAlphanumeric(char c)
+{
+    return isAsciiUpper(c) || isAsciiDigit(c) || (c >= 'a' && c <= 'z');
+}
+
+// Non-ASCII bytes are treated as letters.
+inline bool isWordByte(char c)
+{
+    return (c & 0x80) != 0 || isAsciiAlphanumeric(c);
+}
+
+inline quint32 trigram(const char *str)
+{
+    return toLowerAscii(str[0]) << 16 | toLowerAscii(str[1]) << 8 | toLowerAscii(str[2]);
+}
+
+// Splits \a str at runs of scope separators.
+QList<QByteArray> scopeComponents(const QByteArray &str)
+{
+    QList<QByteArray> components;
+
+    int start = 0;
+    for (int i = 0; i <= str.size(); ++i) {
+        if (i < str.size() && !Scorer::isScopeSeparator(str.at(i)))
+            continue;
+
+        if (i > start)
+            components.append(str.mid(start, i - start));
+        start = i + 1;
+    }
+
+    return components;
+}
+
+// Returns true if \a name has \a qualifiers right before the member starting at \a memberStart.
+bool hasQualifiers(const char *name, int memberStart, const QList<QByteArray> &qualifiers)
+{
+    int position = memberStart;
+
+    for (int i = qualifiers.size() - 1; i >= 0; --i) {
+        while (position > 0 && Scorer::isScopeSeparator(name[position - 1]))
+            --position;
+
+        const QByteArray &qualifier = qualifiers.at(i);
+        const int start = position - qualifier.size();
+        if (start < 0 || (start > 0 && !Scorer::isScopeSeparator(name[start - 1])))
+            return false;
+
+        for (int j = 0; j < qualifier.size(); ++j) {
+            if (toLowerAscii(name[start + j]) != toLowerAscii(qualifier.at(j)))
+                return false;
+        }
+
+        position = start;
+    }
+
+    return true;
+}
+
+// Returns the edit distance between \a needle and the closest suffix of \a name, which starts
+// at a component boundary, or a value above \a maxDistance. Both strings must be normalized.
+int suffixDistance(const char *name, int nameLength, const char *needle, int needleLength,
+                   int maxDistance)
+{
+    int rows[3][MaxTypoNeedleLength + 1];
+    int *beforePrevious = rows[0];
+    int *previous = rows[1];
+    int *current = rows[2];
+
+    // Suffixes start after dots, so distance cannot grow past the last one.
+    int lastBoundary = nameLength;
+    while (lastBoundary > 0 && name[lastBoundary - 1] != '.')
+        --lastBoundary;
+
+    std::iota(previous, previous + needleLength + 1, 0);
+
+    for (int i = 1; i <= nameLength; ++i) {
+        const char c = name[i - 1];
+
+        current[0] = c == '.' ? 0 : previous[0] + 1;
+        int rowMin = current[0];
+
+        for (int j = 1; j <= needleLength; ++j) {
+            int distance = qMin(previous[j], current[j - 1]) + 1;
+            distance = qMin(distance, previous[j - 1] + (c == needle[j - 1] ? 0 : 1));
+            if (i > 1 && j > 1 && c == needle[j - 2] && name[i - 2] == needle[j - 1])
+                distance = qMin(distance, beforePrevious[j - 2] + 1);
+
+            current[j] = distance;
+            rowMin = qMin(rowMin, distance);
+        }
+
+        if (rowMin > maxDistance && i >= lastBoundary)
+            return maxDistance + 1;
+
+        std::swap(beforePrevious, previous);
+        std::swap(previous, current);
+    }
+
+    return previous[needleLength];
+}
+
+// Keeps only \a candidates found in sorted \a postings. Postings are searched with
+// galloping, so the cost depends on the number of candidates rather than postings.
+void intersectPostings(QVector<int> &candidates, const int *postings, int size)
+{
+    int position = 0;
+    int count = 0;
+
+    for (int i = 0; i < candidates.size() && position < size; ++i) {
+        const int candidate = candidates.at(i);
+
+        int bound = position;
+        int step = 1;
+        while (bound < size && postings[bound] < candidate) {
+            position = bound + 1;
+            bound = position + step;
+            step *= 2;
+        }
+
+        const int end = qMin(bound + 1, size);
+        position = static_cast<int>(std::lower_bound(postings + position, postings + end, candidate) - postings);
+
+        if (position < size && postings[position] == candidate)
+            candidates[count++] = candidate;
+    }
+
+    candidates.resize(count);
+}
+} // namespace
+
+SymbolIndex::SymbolIndex()
+{
+    appendValue<int>(m_nameOffsets, 0);
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    delete m_file;
+}
+
+void SymbolIndex::append(const QByteArray &name, const QByteArray &type,
+                         const QByteArray &path, const QByteArray &fragment)
+{
+    m_names.append(name).append('\0').append('\0');
+    appendValue<int>(m_nameOffsets, m_names.size());
+
+    appendValue<int>(m_pathOffsets, m_urls.size());
+    m_urls.append(path).append('\0');
+    appendValue<int>(m_fragmentOffsets, m_urls.size());
+    m_urls.append(fragment).append('\0');
+
+    auto it = m_typeIdHash.constFind(type);
+    if (it == m_typeIdHash.cend()) {
+        // Deep copy, since the type may point to a temporary buffer.
+        it = m_typeIdHash.insert(QByteArray(type.constData(), type.size()),
+                                 static_cast<quint16>(m_types.size()));
+        m_types.append(QString::fromUtf8(type));
+    }
+
+    appendValue<quint16>(m_typeIds, it.value());
+    ++m_count;
+}
+
+void SymbolIndex::squeeze()
+{
+    m_names.squeeze();
+    m_normalizedNames = Scorer::normalize(m_names);
+    m_nameOffsets.squeeze();
+    m_urls.squeeze();
+
+    m_signatures.clear();
+    m_signatures.reserve(m_count * static_cast<int>(sizeof(quint64)));
+    for (int i = 0; i < m_count; ++i)
+        appendValue<quint64>(m_signatures, Scorer::signature(name(i), nameLength(i)));
+
+    m_pathOffsets.squeeze();
+    m_fragmentOffsets.squeeze();
+    m_typeIds.squeeze();
+
+    buildTrigramIndex();
+    buildPrefixIndex();
+    buildAcronymIndex();
+
+    // Only needed while appending.
+    m_typeIdHash.clear();
+}
+
+SymbolIndex *SymbolIndex::map(const QString &fileName, const QVector<qint64> &sourceStamps)
+{
+    QScopedPointer<QFile> file(new QFile(fileName));
+    if (!file->open(QIODevice::ReadOnly))
+        return nullptr;
+
+    const qint64 fileSize = file->size();
+    if (fileSize < static_cast<qint64>(sizeof(FileHeader)))
+        return nullptr;
+
+    const uchar *data = file->map(0, fileSize);
+    if (data == nullptr)
+        return nullptr;
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(FileHeader));
+
+    if (std::memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) != 0
+            || header.version != IndexVersion || header.byteOrderMark != ByteOrderMark) {
+        return nullptr;
+    }
+
+    // Outdated, the database has changed since the index was saved.
+    if (header.sourceStampCount != sourceStamps.size()
+            || !std::equal(sourceStamps.cbegin(), sourceStamps.cend(), header.sourceStamps)) {
+        return nullptr;
+    }
+
+    for (const auto &section : header.sections) {
+        if (section.offset < static_cast<qint64>(sizeof(FileHeader)) || section.offset % 8 != 0
+                || section.size < 0 || section.offset + section.size > fileSize) {
+            qWarning("Symbol index '%s' is corrupted.", qPrintable(fileName));
+            return nullptr;
+        }
+    }
+
+    auto section = [data, &header](Section id) {
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(data) + header.sections[id].offset,
+                                       static_cast<int>(header.sections[id].size));
+    };
+
+    QScopedPointer<SymbolIndex> index(new SymbolIndex());
+    index->m_count = header.count;
+    index->m_names = section(Names);
+    index->m_normalizedNames = section(NormalizedNames);
+    index->m_nameOffsets = section(NameOffsets);
+    index->m_signatures = section(Signatures);
+    index->m_urls = section(Urls);
+    index->m_pathOffsets = section(PathOffsets);
+    index->m_fragmentOffsets = section(FragmentOffsets);
+    index->m_typeIds = section(TypeIds);
+    index->m_trigrams = section(Trigrams);
+    index->m_trigramOffsets = section(TrigramOffsets);
+    index->m_trigramPostings = section(TrigramPostings);
+    index->m_prefixOrder = section(PrefixOrder);
+    index->m_componentOrder = section(ComponentOrder);
+    index->m_memberOffsets = section(MemberOffsets);
+    index->m_memberOrder = section(MemberOrder);
+    index->m_acronyms = section(Acronyms);
+    index->m_acronymOffsets = section(AcronymOffsets);
+    index->m_memberAcronymOffsets = section(MemberAcronymOffsets);
+    index->m_acronymOrder = section(AcronymOrder);
+    index->m_memberAcronymOrder = section(MemberAcronymOrder);
+
+    // Each type is followed by a NUL byte.
+    QList<QByteArray> types = section(Types).split('\0');
+    types.removeLast();
+    for (const QByteArray &type : qAsConst(types))
+        index->m_types.append(QString::fromUtf8(type));
+
+    const int count = header.count;
+    const int trigramCount = index->m_trigrams.size() / static_cast<int>(sizeof(quint32));
+    if (count < 0
+            || index->m_nameOffsets.size() != (count + 1) * static_cast<int>(sizeof(int))
+            || index->nameOffsets()[count] != index->m_names.size()
+            || index->m_normalizedNames.size() != index->m_names.size()
+            || index->m_signatures.size() != count * static_cast<int>(sizeof(quint64))
+            || index->m_pathOffsets.size() != count * static_cast<int>(sizeof(int))
+            || index->m_fragmentOffsets.size() != count * static_cast<int>(sizeof(int))
+            || index->m_typeIds.size() != count * static_cast<int>(sizeof(quint16))
+            || index->m_trigramOffsets.size() != (trigramCount + 1) * static_cast<int>(sizeof(int))
+            || index->m_prefixOrder.size() != count * static_cast<int>(sizeof(int))
+            || index->m_componentOrder.size() != count * static_cast<int>(sizeof(int))
+            || index->m_memberOffsets.size() != count * static_cast<int>(sizeof(int))
+            || index->m_memberOrder.size() != count * static_cast<int>(sizeof(int))
+            || index->m_acronymOffsets.size() != (count + 1) * static_cast<int>(sizeof(int))
+            || values<int>(index->m_acronymOffsets)[count] != index->m_acronyms.size()
+            || index->m_memberAcronymOffsets.size() != count * static_cast<int>(sizeof(int))
+            || index->m_acronymOrder.size() != count * static_cast<int>(sizeof(int))
+            || index->m_memberAcronymOrder.size() != count * static_cast<int>(sizeof(int))) {
+        qWarning("Symbol index '%s' is corrupted.", qPrintable(fileName));
+        return nullptr;
+    }
+
+    index->m_file = file.take();
+    return index.take();
+}
+
+bool SymbolIndex::save(const QString &fileName, const QVector<qint64> &sourceStamps) const
+{
+    if (sourceStamps.size() > MaxSourceStampCount)
+        return false;
+
+    QByteArray types;
+    for (const QString &type : m_types)
+        types.append(type.toUtf8()).append('\0');
+
+    const QByteArray *sections[SectionCount] = {
+        &m_names, &m_normalizedNames, &m_nameOffsets, &m_signatures,
+        &m_urls, &m_pathOffsets, &m_fragmentOffsets,
+        &m_typeIds, &types,
+        &m_trigrams, &m_trigramOffsets, &m_trigramPostings,
+        &m_prefixOrder, &m_componentOrder, &m_memberOffsets, &m_memberOrder,
+        &m_acronyms, &m_acronymOffsets, &m_memberAcronymOffsets,
+        &m_acronymOrder, &m_memberAcronymOrder
+    };
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(FileHeader));
+    std::memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    header.version = IndexVersion;
+    header.byteOrderMark = ByteOrderMark;
+    std::copy(sourceStamps.cbegin(), sourceStamps.cend(), header.sourceStamps);
+    header.sourceStampCount = sourceStamps.size();
+    header.count = m_count;
+
+    qint64 offset = alignedOffset(sizeof(FileHeader));
+    for (int i = 0; i < SectionCount; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sections[i]->size();
+        offset = alignedOffset(offset + sections[i]->size());
+    }
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot save symbol index to '%s': %s",
+                 qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    for (int i = 0; i < SectionCount; ++i) {
+        file.write(QByteArray(static_cast<int>(header.sections[i].offset - file.pos()), '\0'));
+        file.write(*sections[i]);
+    }
+
+    return file.commit();
+}
+
+bool SymbolIndex::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int SymbolIndex::count() const
+{
+    return m_count;
+}
+
+const char *SymbolIndex::normalizedNames() const
+{
+    return m_normalizedNames.constData();
+}
+
+const char *SymbolIndex::path(int index) const
+{
+    return m_urls.constData() + values<int>(m_pathOffsets)[index];
+}
+
+const char *SymbolIndex::fragment(int index) const
+{
+    return m_urls.constData() + values<int>(m_fragmentOffsets)[index];
+}
+
+int SymbolIndex::typeId(int index) const
+{
+    return values<quint16>(m_typeIds)[index];
+}
+
+QString SymbolIndex::typeName(int typeId) const
+{
+    return m_types.at(typeId);
+}
+
+QStringList SymbolIndex::typeNames() const
+{
+    return m_types;
+}
+
+QVector<int> SymbolIndex::substringCandidates(const QList<QByteArray> &needles) const
+{
+    QVector<int> candidates;
+
+    // Posting lists of all needle trigrams, the shortest ones are intersected first.
+    QVector<QPair<const int *, const int *>> lists;
+    for (const QByteArray &needle : needles) {
+        for (int i = 0; i + 3 <= needle.size(); ++i) {
+            const int *first;
+            const int *last;
+            if (!findPostings(trigram(needle.constData() + i), &first, &last))
+                return candidates;
+
+            lists.append({first, last});
+        }
+    }
+
+    if (lists.isEmpty())
+        return candidates;
+
+    std::sort(lists.begin(), lists.end(), [](const QPair<const int *, const int *> &a,
+                                             const QPair<const int *, const int *> &b) {
+        return a.second - a.first < b.second - b.first;
+    });
+
+    candidates.reserve(static_cast<int>(lists.first().second - lists.first().first));
+    std::copy(lists.first().first, lists.first().second, std::back_inserter(candidates));
+
+    for (int i = 1; i < lists.size() && !candidates.isEmpty(); ++i) {
+        // Repeated trigrams produce identical lists.
+        if (lists.at(i) == lists.at(i - 1))
+            continue;
+
+        intersectPostings(candidates, lists.at(i).first,
+                          static_cast<int>(lists.at(i).second - lists.at(i).first));
+    }
+
+    return candidates;
+}
+
+QVector<int> SymbolIndex::prefixCandidates(const QByteArray &prefix, int limit) const
+{
+    QVector<int> candidates;
+
+    const char *names = m_normalizedNames.constData();
+    const int *nameOffsets = this->nameOffsets();
+
+    auto appendRange = [&](const QByteArray &order, bool byComponent) {
+        auto key = [&](int position) {
+            const char *name = names + nameOffsets[position];
+            return byComponent ? lastComponent(name) : name;
+        };
+
+        const int *first = values<int>(order);
+        const int *last = first + m_count;
+
+        first = std::lower_bound(first, last, prefix, [&](int position, const QByteArray &p) {
+            return std::strncmp(key(position), p.constData(), p.size()) < 0;
+        });
+        last = std::upper_bound(first, last, prefix, [&](const QByteArray &p, int position) {
+            return std::strncmp(key(position), p.constData(), p.size()) > 0;
+        });
+
+        std::copy(first, first + qMin<ptrdiff_t>(last - first, limit), std::back_inserter(candidates));
+    };
+
+    appendRange(m_prefixOrder, false);
+    appendRange(m_componentOrder, true);
+
+    // Names without separators are in both ranges.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    return candidates;
+}
+
+QVector<SymbolIndex::ScopedMatch> SymbolIndex::scopedCandidates(const QByteArray &query) const
+{
+    QVector<ScopedMatch> candidates;
+
+    // Members of a scope cannot be resolved by the last component.
+    if (query.isEmpty() || Scorer::isScopeSeparator(query.at(query.size() - 1)))
+        return candidates;
+
+    QList<QByteArray> qualifiers = scopeComponents(query);
+    if (qualifiers.size() < 2)
+        return candidates;
+
+    const QByteArray member = Scorer::normalize(qualifiers.takeLast());
+
+    const char *names = m_normalizedNames.constData();
+    const int *memberOffsets = values<int>(m_memberOffsets);
+
+    const int *first = values<int>(m_memberOrder);
+    const int *last = first + m_count;
+
+    first = std::lower_bound(first, last, member, [&](int position, const QByteArray &m) {
+        return std::strncmp(names + memberOffsets[position], m.constData(), m.size()) < 0;
+    });
+    last = std::upper_bound(first, last, member, [&](const QByteArray &m, int position) {
+        return std::strncmp(names + memberOffsets[position], m.constData(), m.size()) > 0;
+    });
+
+    for (const int *it = first; it != last; ++it) {
+        const int memberStart = memberOffsets[*it] - nameOffsets()[*it];
+        if (hasQualifiers(name(*it), memberStart, qualifiers))
+            candidates.append({*it, nameLength(*it) - memberStart});
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const ScopedMatch &a, const ScopedMatch &b) {
+        return a.index < b.index;
+    });
+    return candidates;
+}
+
+QVector<SymbolIndex::AcronymMatch> SymbolIndex::acronymCandidates(const QByteArray &needle,
+                                                                  int limit) const
+{
+    QVector<AcronymMatch> candidates;
+
+    const char *acronyms = m_acronyms.constData();
+    const int *memberOffsets = values<int>(m_memberOffsets);
+
+    auto appendRange = [&](const QByteArray &order, bool byMember) {
+        const int *acronymOffsets = values<int>(byMember ? m_memberAcronymOffsets : m_acronymOffsets);
+        auto key = [&](int position) {
+            return acronyms + acronymOffsets[position];
+        };
+
+        const int *first = values<int>(order);
+        const int *last = first + m_count;
+
+        first = std::lower_bound(first, last, needle, [&](int position, const QByteArray &n) {
+            return std::strncmp(key(position), n.constData(), n.size()) < 0;
+        });
+        last = std::upper_bound(first, last, needle, [&](const QByteArray &n, int position) {
+            return std::strncmp(key(position), n.constData(), n.size()) > 0;
+        });
+
+        last = first + qMin<ptrdiff_t>(last - first, limit);
+        for (const int *it = first; it != last; ++it) {
+            const int start = byMember ? memberOffsets[*it] - nameOffsets()[*it] : 0;
+            candidates.append({*it, nameLength(*it) - start});
+        }
+    };
+
+    appendRange(m_acronymOrder, false);
+    appendRange(m_memberAcronymOrder, true);
+
+    // Names without scope separators are in both ranges, the shorter part is kept.
+    std::sort(candidates.begin(), candidates.end(), [](const AcronymMatch &a, const AcronymMatch &b) {
+        return a.index != b.index ? a.index < b.index : a.length < b.length;
+    });
+    candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                 [](const AcronymMatch &a, const AcronymMatch &b) {
+        return a.index == b.index;
+    }), candidates.end());
+
+    return candidates;
+}
+
+QVector<SymbolIndex::TypoMatch> SymbolIndex::typoCandidates(const QByteArray &needle,
+                                                            int maxDistance, int limit) const
+{
+    // Bounds the time spent on needles made of common trigrams.
+    static const int MaxCheckedNameCount = 20000;
+
+    QVector<TypoMatch> matches;
+
+    if (needle.size() > MaxTypoNeedleLength || needle.size() <= maxDistance)
+        return matches;
+
+    QVector<quint32> keys;
+    for (int i = 0; i + 3 <= needle.size(); ++i)
+        keys.append(trigram(needle.constData() + i));
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // Each edit changes at most three trigrams, the rest is shared with a matching name.
+    // At least one shared trigram is required, so very short needles may miss some names.
+    const int minSharedCount = qMax(1, keys.size() - 3 * maxDistance);
+
+    // Counters are reused by each thread, and only those touched here are cleared again,
+    // so that a query does not allocate and clear one for every name.
+    static thread_local QVector<quint8> sharedCounts;
+    if (sharedCounts.size() < m_count)
+        sharedCounts.resize(m_count);
+
+    QVector<QPair<const int *, const int *>> postings;
+    for (quint32 key : keys) {
+        const int *first;
+        const int *last;
+        if (findPostings(key, &first, &last))
+            postings.append({first, last});
+    }
+
+    QVector<int> candidates;
+    for (const auto &range : qAsConst(postings)) {
+        for (const int *it = range.first; it != range.second; ++it) {
+            if (++sharedCounts[*it] == minSharedCount)
+                candidates.append(*it);
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](int a, int b) {
+        return sharedCounts.at(a) > sharedCounts.at(b);
+    });
+
+    for (const auto &range : qAsConst(postings)) {
+        for (const int *it = range.first; it != range.second; ++it)
+            sharedCounts[*it] = 0;
+    }
+
+    const QByteArray normalizedNeedle = Scorer::normalize(needle);
+
+    const int checkedCount = qMin(candidates.size(), MaxCheckedNameCount);
+    for (int i = 0; i < checkedCount && matches.size() < limit; ++i) {
+        const int position = candidates.at(i);
+        const int distance = suffixDistance(normalizedName(position), nameLength(position),
+                                            normalizedNeedle.constData(), normalizedNeedle.size(),
+                                            maxDistance);
+        if (distance <= maxDistance)
+            matches.append({position, distance});
+    }
+
+    return matches;
+}
+
+bool SymbolIndex::findPostings(quint32 key, const int **first, const int **last) const
+{
+    const quint32 *trigrams = values<quint32>(m_trigrams);
+    const int trigramCount = m_trigrams.size() / static_cast<int>(sizeof(quint32));
+
+    const quint32 *it = std::lower_bound(trigrams, trigrams + trigramCount, key);
+    if (it == trigrams + trigramCount || *it != key)
+        return false;
+
+    const int position = static_cast<int>(it - trigrams);
+    const int *offsets = values<int>(m_trigramOffsets);
+    const int *postings = values<int>(m_trigramPostings);
+
+    *first = postings + offsets[position];
+    *last = postings + offsets[position + 1];
+    return true;
+}
+
+void SymbolIndex::buildTrigramIndex()
+{
+    // Pairs of a trigram in the upper half and a symbol position in the lower one.
+    QVector<quint64> pairs;
+    pairs.reserve(m_names.size());
+
+    QVector<quint32> symbolTrigrams;
+    for (int i = 0; i < m_count; ++i) {
+        const char *str = name(i);
+        const int length = nameLength(i);
+
+        symbolTrigrams.clear();
+        for (int j = 0; j + 3 <= length; ++j)
+            symbolTrigrams.append(trigram(str + j));
+
+        std::sort(symbolTrigrams.begin(), symbolTrigrams.end());
+        const auto end = std::unique(symbolTrigrams.begin(), symbolTrigrams.end());
+
+        for (auto it = symbolTrigrams.begin(); it != end; ++it)
+            pairs.append(static_cast<quint64>(*it) << 32 | static_cast<quint32>(i));
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+
+    m_trigrams.clear();
+    m_trigramOffsets.clear();
+    m_trigramPostings.resize(pairs.size() * static_cast<int>(sizeof(int)));
+
+    int *postings = reinterpret_cast<int *>(m_trigramPostings.data());
+    for (int i = 0; i < pairs.size(); ++i) {
+        const auto key = static_cast<quint32>(pairs.at(i) >> 32);
+        if (i == 0 || key != static_cast<quint32>(pairs.at(i - 1) >> 32)) {
+            appendValue<quint32>(m_trigrams, key);
+            appendValue<int>(m_trigramOffsets, i);
+        }
+
+        postings[i] = static_cast<int>(pairs.at(i) & 0xffffffff);
+    }
+
+    appendValue<int>(m_trigramOffsets, pairs.size());
+}
+
+void SymbolIndex::buildPrefixIndex()
+{
+    const char *names = m_normalizedNames.constData();
+    const int *nameOffsets = this->nameOffsets();
+
+    QVector<int> order(m_count);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::sort(order.begin(), order.end(), [names, nameOffsets](int a, int b) {
+        return std::strcmp(names + nameOffsets[a], names + nameOffsets[b]) < 0;
+    });
+    m_prefixOrder = QByteArray(reinterpret_cast<const char *>(order.constData()),
+                               order.size() * static_cast<int>(sizeof(int)));
+
+    std::sort(order.begin(), order.end(), [names, nameOffsets](int a, int b) {
+        return std::strcmp(lastComponent(names + nameOffsets[a]),
+                           lastComponent(names + nameOffsets[b])) < 0;
+    });
+    m_componentOrder = QByteArray(reinterpret_cast<const char *>(order.constData()),
+                                  order.size() * static_cast<int>(sizeof(int)));
+
+    m_memberOffsets.clear();
+    for (int i = 0; i < m_count; ++i) {
+        int start = nameOffsets[i] + nameLength(i);
+        while (start > nameOffsets[i] && !Scorer::isScopeSeparator(m_names.at(start - 1)))
+            --start;
+
+        appendValue<int>(m_memberOffsets, start);
+    }
+
+    const int *memberOffsets = values<int>(m_memberOffsets);
+    std::sort(order.begin(), order.end(), [names, memberOffsets](int a, int b) {
+        return std::strcmp(names + memberOffsets[a], names + memberOffsets[b]) < 0;
+    });
+    m_memberOrder = QByteArray(reinterpret_cast<const char *>(order.constData()),
+                               order.size() * static_cast<int>(sizeof(int)));
+}
+
+void SymbolIndex::buildAcronymIndex()
+{
+    m_acronyms.clear();
+    m_acronymOffsets.clear();
+    m_memberAcronymOffsets.clear();
+
+    for (int i = 0; i < m_count; ++i) {
+        const char *str = name(i);
+        const int length = nameLength(i);
+
+        appendValue<int>(m_acronymOffsets, m_acronyms.size());
+        int memberOffset = m_acronyms.size();
+
+        // Words start after punctuation, at each uppercase letter, and at each number.
+        for (int j = 0; j < length; ++j) {
+            const char c = str[j];
+            if (Scorer::isScopeSeparator(c))
+                memberOffset = m_acronyms.size();
+
+            if (!isAsciiAlphanumeric(c))
+                continue;
+
+            const char previous = j > 0 ? str[j - 1] : '\0';
+            if (!isWordByte(previous) || isAsciiUpper(c) || (isAsciiDigit(c) && !isAsciiDigit(previous)))
+                m_acronyms.append(static_cast<char>(toLowerAscii(c)));
+        }
+
+        m_acronyms.append('\0');
+        appendValue<int>(m_memberAcronymOffsets, memberOffset);
+    }
+
+    appendValue<int>(m_acronymOffsets, m_acronyms.size());
+
+    const char *acronyms = m_acronyms.constData();
+
+    auto sortedOrder = [this, acronyms](const QByteArray &offsets) {
+        const int *acronymOffsets = values<int>(offsets);
+
+        QVector<int> order(m_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [acronyms, acronymOffsets](int a, int b) {
+            return std::strcmp(acronyms + acronymOffsets[a], acronyms + acronymOffsets[b]) < 0;
+        });
+
+        return QByteArray(reinterpret_cast<const char *>(order.constData()),
+                          order.size() * static_cast<int>(sizeof(int)));
+    };
+
+    m_acronymOrder = sortedOrder(m_acronymOffsets);
+    m_memberAcronymOrder = sortedOrder(m_memberAcronymOffsets);
+}
@@ -0,0 +1,206 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+#ifndef ZEAL_REGISTRY_SYMBOLINDEX_H
+#define ZEAL_REGISTRY_SYMBOLINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class QFile;
+
+namespace Zeal {
+namespace Registry {
+
+/**
+ * @short Compact in-memory copy of the docset search index.
+ *
+ * All symbol names are stored in a single NUL-separated UTF-8 arena, and
+ * per-symbol data lives in parallel arrays indexed by the symbol position.
+ * Paths and fragments share a second arena, so the whole index is just a
+ * handful of allocations regardless of the number of symbols.
+ *
+ * Each name is followed by two NUL bytes, as required by Scorer, and a copy
+ * of the name arena normalized for scoring shares the same offsets.
+ *
+ * Each name has a 64-bit signature of its character classes, see
+ * Scorer::signature(), which rejects most names before any string is compared.
+ *
+ * A trigram index maps each ASCII-lowercased three byte sequence to sorted
+ * positions of the names containing it, which narrows down substring search.
+ * Two more arrays list symbols in the order of their normalized names, and of
+ * the last components of those, so that prefix matches are found by bisection.
+ * A third one orders them by the member after the last scope separator, see
+ * Scorer::isScopeSeparator(). It works as a flattened trie of the last components, and
+ * the qualifiers preceding a member in the name serve as links to its parents.
+ *
+ * Initials of words in each name (camel case humps and parts separated by
+ * punctuation) form an acronym, which is also sorted for prefix lookups, both
+ * in full and for the part after the last scope separator.
+ *
+ * Names with typos are found by counting trigrams shared with the needle, and
+ * checking names with the most shared trigrams first.
+ *
+ * The index can be saved into a file, which is later memory-mapped instead of
+ * being rebuilt. Arrays are then used in place, and the OS page cache shares
+ * them between processes.
+ */
+class SymbolIndex final
+{
+    Q_DISABLE_COPY(SymbolIndex)
+public:
+    struct AcronymMatch {
+        int index;
+        int length; ///< Length of the name part, whose initials start with the needle.
+    };
+
+    struct ScopedMatch {
+        int index;
+        int length; ///< Length of the last scope member.
+    };
+
+    struct TypoMatch {
+        int index;
+        int distance;
+    };
+
+    SymbolIndex();
+    ~SymbolIndex();
+
+    void append(const QByteArray &name, const QByteArray &type,
+                const QByteArray &path, const QByteArray &fragment);
+    /// Finishes building the index, must be called after the last append().
+    void squeeze();
+
+    /// Maps an index saved by save(). Returns nullptr if the file is missing, corrupted,
+    /// or was saved for a database with different \a sourceStamps.
+    static SymbolIndex *map(const QString &fileName, const QVector<qint64> &sourceStamps);
+    bool save(const QString &fileName, const QVector<qint64> &sourceStamps) const;
+
+    bool isEmpty() const;
+    int count() const;
+
+    inline const char *name(int index) const
+    {
+        return m_names.constData() + nameOffsets()[index];
+    }
+
+    inline int nameLength(int index) const
+    {
+        return nameOffsets()[index + 1] - nameOffsets()[index] - 2;
+    }
+
+    inline const char *normalizedName(int index) const
+    {
+        return m_normalizedNames.constData() + nameOffsets()[index];
+    }
+
+    const char *normalizedNames() const;
+
+    inline const int *nameOffsets() const
+    {
+        return reinterpret_cast<const int *>(m_nameOffsets.constData());
+    }
+
+    inline const quint64 *signatures() const
+    {
+        return reinterpret_cast<const quint64 *>(m_signatures.constData());
+    }
+
+    const char *path(int index) const;
+    const char *fragment(int index) const;
+
+    int typeId(int index) const;
+    QString typeName(int typeId) const;
+    QStringList typeNames() const;
+
+    /// Returns sorted positions of symbols, whose names may contain all \a needles
+    /// ignoring ASCII case. Needles shorter than three bytes are ignored, but at least
+    /// one must be longer.
+    QVector<int> substringCandidates(const QList<QByteArray> &needles) const;
+
+    /// Returns sorted positions of symbols, whose normalized names or their last
+    /// components start with normalized \a prefix. At most \a limit symbols are
+    /// taken from each of the two ranges.
+    QVector<int> prefixCandidates(const QByteArray &prefix, int limit) const;
+
+    /// Returns symbols sorted by position, whose last scope members start with the last
+    /// component of \a query, and whose qualifiers end with the other components. Components
+    /// may be separated by any scope separators, and are compared ignoring ASCII case.
+    /// Returns nothing if \a query is not qualified.
+    QVector<ScopedMatch> scopedCandidates(const QByteArray &query) const;
+
+    /// Returns symbols, whose acronyms or acronyms of their last scope members start with
+    /// lowercase \a needle. At most \a limit symbols are taken from each of the two ranges.
+    QVector<AcronymMatch> acronymCandidates(const QByteArray &needle, int limit) const;
+
+    /// Returns up to \a limit symbols, whose normalized names end with a component chain
+    /// within \a maxDistance edits from normalized \a needle. Adjacent transpositions count
+    /// as a single edit. Matches are not sorted, and needles longer than 64 bytes are ignored.
+    QVector<TypoMatch> typoCandidates(const QByteArray &needle, int maxDistance, int limit) const;
+
+private:
+    bool findPostings(quint32 key, const int **first, const int **last) const;
+
+    void buildTrigramIndex();
+    void buildPrefixIndex();
+    void buildAcronymIndex();
+
+    // Arrays of integers are stored in byte arrays as well, so that they can wrap mapped memory.
+    QByteArray m_names;
+    QByteArray m_normalizedNames;
+    QByteArray m_nameOffsets; // int
+    QByteArray m_signatures; // quint64
+
+    QByteArray m_urls;
+    QByteArray m_pathOffsets; // int
+    QByteArray m_fragmentOffsets; // int
+
+    QByteArray m_typeIds; // quint16
+    QStringList m_types;
+    QHash<QByteArray, quint16> m_typeIdHash;
+
+    QByteArray m_trigrams; // quint32, sorted
+    QByteArray m_trigramOffsets; // int, into postings
+    QByteArray m_trigramPostings; // int
+
+    QByteArray m_prefixOrder; // int, positions sorted by normalized name
+    QByteArray m_componentOrder; // int, positions sorted by last normalized name component
+    QByteArray m_memberOffsets; // int, into names, after the last scope separator
+    QByteArray m_memberOrder; // int, positions sorted by normalized member
+
+    QByteArray m_acronyms; // NUL-separated lowercase initials
+    QByteArray m_acronymOffsets; // int
+    QByteArray m_memberAcronymOffsets; // int, initials after the last scope separator
+    QByteArray m_acronymOrder; // int, positions sorted by acronym
+    QByteArray m_memberAcronymOrder; // int, positions sorted by member acronym
+
+    int m_count = 0;
+
+    QFile *m_file = nullptr; // Mapped index file.
+};
+
+} // namespace Registry
+} // namespace Zeal
+
+#endif // ZEAL_REGISTRY_SYMBOLINDEX_H
@@ -0,0 +1,293 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Copyright (C) 2013-2014 Jerzy Kozera
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <registry/fuzzymatcher.h>
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include <limits>
+#include <random>
+
+using namespace Zeal::Registry;
+
+Q_DECLARE_METATYPE(FuzzyMatcher::Mode)
+
+namespace {
+// Generous enough for debug builds, while the recursive matcher took seconds on such names.
+const qint64 MaxMatchTime = 10; // ms, per name
+
+// The recursive matcher, which was used before FuzzyMatcher. Compatible mode must return
+// the same matches.
+void matchRecursive(const char *needle, int needleLength,
+                    const char *haystack, int haystackLength,
+                    int *start, int *length)
+{
+    *start = -1;
+
+    int groupCount = 0;
+    int bestRecursiveScore = -1;
+    int bestRecursiveStart = -1;
+    int bestRecursiveLength = -1;
+
+    for (int i = 0, j = 0; i < needleLength; ++i) {
+        bool found = false;
+        bool first = true;
+        int distance = 0;
+
+        while (j < haystackLength) {
+            if (needle[i] == haystack[j++]) {
+                if (*start == -1) {
+                    *start = j;
+
+                    int recursiveStart;
+                    int recursiveLength;
+                    matchRecursive(needle, needleLength, haystack + j, haystackLength - j,
+                                   &recursiveStart, &recursiveLength);
+                    if (recursiveStart != -1) {
+                        const int recursiveScore
+                                = FuzzyMatcher::score(haystack, recursiveStart, recursiveLength);
+                        if (recursiveScore > bestRecursiveScore) {
+                            bestRecursiveScore = recursiveScore;
+                            bestRecursiveStart = recursiveStart;
+                            bestRecursiveLength = recursiveLength;
+                        }
+                    }
+                }
+
+                *length = j - *start + 1;
+                found = true;
+                break;
+            }
+
+            if (first) {
+                if (++groupCount >= FuzzyMatcher::MaxGroupCount)
+                    break;
+
+                first = false;
+            }
+
+            if (i != 0 && ++distance >= FuzzyMatcher::MaxDistance)
+                break;
+        }
+
+        if (!found) {
+            if (bestRecursiveScore != -1) {
+                *start = bestRecursiveStart;
+                *length = bestRecursiveLength;
+            } else {
+                *start = -1;
+            }
+            return;
+        }
+    }
+
+    if (bestRecursiveScore > FuzzyMatcher::score(haystack, *start, *length)) {
+        *start = bestRecursiveStart;
+        *length = bestRecursiveLength;
+    }
+}
+
+// Returns the best score of all matches of needle[i..] following a match ending at \a last.
+int bestScore(const QByteArray &needle, const QByteArray &haystack,
+              int i, int first, int last, int gapCount)
+{
+    if (i == needle.size())
+        return FuzzyMatcher::score(haystack.constData(), first, last - first + 1);
+
+    int result = 0;
+    for (int j = last + 1; j < haystack.size() && j - last - 1 < FuzzyMatcher::MaxDistance; ++j) {
+        if (haystack.at(j) != needle.at(i))
+            continue;
+
+        const int gaps = gapCount + (j - last > 1 ? 1 : 0);
+        if (gaps < FuzzyMatcher::MaxGroupCount)
+            result = qMax(result, bestScore(needle, haystack, i + 1, first, j, gaps));
+    }
+
+    return result;
+}
+
+// Exhaustive search for the score BestMatch mode must find, 0 if there is no match.
+int bestScore(const QByteArray &needle, const QByteArray &haystack)
+{
+    int result = 0;
+    for (int j = 0; j < haystack.size(); ++j) {
+        if (haystack.at(j) == needle.at(0))
+            result = qMax(result, bestScore(needle, haystack, 1, j, j, 0));
+    }
+
+    return result;
+}
+
+// FuzzyMatcher expects two NUL bytes after names, QByteArray only has one.
+QByteArray padded(const QByteArray &name)
+{
+    return name + '\0';
+}
+
+QByteArray repeated(const QByteArray &str, int length)
+{
+    QByteArray result;
+    while (result.size() < length)
+        result += str;
+
+    return result.left(length);
+}
+} // namespace
+
+class FuzzyMatcherTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compatibleMatchesRecursive();
+    void bestMatchFindsBestScore();
+    void adversarialNames_data();
+    void adversarialNames();
+};
+
+// Short random names over a small alphabet exercise repeated characters, gaps and dots.
+void FuzzyMatcherTest::compatibleMatchesRecursive()
+{
+    std::mt19937 random(42);
+    const char alphabet[] = "aab.c";
+
+    const FuzzyMatcher matcher(FuzzyMatcher::Mode::Compatible);
+    for (int iteration = 0; iteration < 100000; ++iteration) {
+        QByteArray haystack;
+        QByteArray needle;
+        const int haystackLength = static_cast<int>(random() % 24) + 1;
+        const int needleLength = qMin(static_cast<int>(random() % 4) + 1, haystackLength);
+        for (int i = 0; i < haystackLength; ++i)
+            haystack += alphabet[random() % 5];
+        for (int i = 0; i < needleLength; ++i)
+            needle += alphabet[random() % 5];
+
+        int expectedStart;
+        int expectedLength = -1;
+        matchRecursive(needle.constData(), needle.size(), haystack.constData(), haystack.size(),
+                       &expectedStart, &expectedLength);
+
+        int start = -1;
+        int length = -1;
+        const bool found = matcher.match(needle.constData(), needle.size(),
+                                         padded(haystack).constData(), haystack.size(),
+                                         &start, &length);
+
+        const QByteArray message = needle + " in " + haystack;
+        QVERIFY2(found == (expectedStart != -1), message.constData());
+        if (found) {
+            QVERIFY2(start == expectedStart, message.constData());
+            QVERIFY2(length == expectedLength, message.constData());
+        }
+    }
+}
+
+void FuzzyMatcherTest::bestMatchFindsBestScore()
+{
+    std::mt19937 random(42);
+    const char alphabet[] = "aab.c";
+
+    const FuzzyMatcher matcher(FuzzyMatcher::Mode::BestMatch);
+    for (int iteration = 0; iteration < 100000; ++iteration) {
+        QByteArray haystack;
+        QByteArray needle;
+        const int haystackLength = static_cast<int>(random() % 24) + 1;
+        const int needleLength = qMin(static_cast<int>(random() % 4) + 1, haystackLength);
+        for (int i = 0; i < haystackLength; ++i)
+            haystack += alphabet[random() % 5];
+        for (int i = 0; i < needleLength; ++i)
+            needle += alphabet[random() % 5];
+
+        int start;
+        int length;
+        const bool found = matcher.match(needle.constData(), needle.size(),
+                                         padded(haystack).constData(), haystack.size(),
+                                         &start, &length);
+        const int score = found ? FuzzyMatcher::score(haystack.constData(), start, length) : 0;
+
+        const QByteArray message = needle + " in " + haystack;
+        QVERIFY2(score == bestScore(needle, haystack), message.constData());
+    }
+}
+
+void FuzzyMatcherTest::adversarialNames_data()
+{
+    QTest::addColumn<FuzzyMatcher::Mode>("mode");
+    QTest::addColumn<QByteArray>("needle");
+    QTest::addColumn<QByteArray>("haystack");
+
+    const QByteArray templateName = "std.vector<std.basic_string<char, std.char_traits<char>, "
+                                    "std.allocator<char>>, std.allocator<std.basic_string<char>>>";
+
+    const QVector<QPair<QByteArray, QByteArray>> names = {
+        {"aaaaaaab", QByteArray(4096, 'a')},
+        {QByteArray(64, 'a').append('z'), QByteArray(4096, 'a')},
+        {QByteArray(16, 'a'), repeated("a.", 4096)},
+        {"abcdefgz", repeated("abcdefg", 4096)},
+        {"aaaaaaab", repeated("aaaaaaaz", 4096)},
+        {"vectorstringq", repeated(templateName, 4096)},
+        {"stdallocator", repeated(templateName, 4096)},
+        {"chartraits", repeated(templateName + "::", 4096)},
+        {"getvalue", repeated("java.util.Map<java.lang.String, java.util.List<java.lang.Object>>.", 4096)},
+    };
+
+    for (const QPair<QByteArray, QByteArray> &name : names) {
+        const QByteArray tag = name.first.left(16) + " in " + name.second.left(16);
+        QTest::addRow("compatible: %s", tag.constData())
+                << FuzzyMatcher::Mode::Compatible << name.first << name.second;
+        QTest::addRow("best match: %s", tag.constData())
+                << FuzzyMatcher::Mode::BestMatch << name.first << name.second;
+    }
+}
+
+// The fastest of a few runs is compared, so that scheduling noise does not fail the test.
+void FuzzyMatcherTest::adversarialNames()
+{
+    QFETCH(FuzzyMatcher::Mode, mode);
+    QFETCH(QByteArray, needle);
+    QFETCH(QByteArray, haystack);
+
+    const FuzzyMatcher matcher(mode);
+    const QByteArray name = padded(haystack);
+
+    qint64 elapsed = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < 3; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+
+        int start;
+        int length;
+        matcher.match(needle.constData(), needle.size(), name.constData(), haystack.size(),
+                      &start, &length);
+
+        elapsed = qMin(elapsed, timer.elapsed());
+    }
+
+    QVERIFY2(elapsed <= MaxMatchTime, qPrintable(QStringLiteral("%1 ms").arg(elapsed)));
+}
+
+QTEST_APPLESS_MAIN(FuzzyMatcherTest)
+
+#include "fuzzymatchertest.moc"
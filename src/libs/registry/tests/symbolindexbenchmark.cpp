@@ -0,0 +1,161 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include <registry/symbolindex.h>
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace Zeal::Registry;
+
+namespace {
+const int SymbolCount = 500000;
+
+// Typo search runs after the regular search on each keystroke, so it gets a fraction
+// of the time a keystroke may take.
+const qint64 MaxTypoSearchTime = 20; // ms, per docset
+
+const char *const Words[] = {
+    "get", "set", "add", "remove", "insert", "erase", "find", "count", "size", "length",
+    "value", "key", "item", "element", "node", "child", "parent", "list", "map", "vector",
+    "string", "buffer", "stream", "file", "path", "name", "type", "index", "begin", "end",
+    "push", "pop", "front", "back", "first", "last", "next", "prev", "read", "write",
+    "open", "close", "load", "save", "create", "destroy", "update", "render", "draw", "event",
+    "handler", "listener", "callback", "request", "response", "header", "body", "query", "result", "error"
+};
+const int WordCount = sizeof(Words) / sizeof(Words[0]);
+
+// Names like those of a large API reference: qualified members made of common words.
+QByteArray randomName(std::mt19937 &random)
+{
+    QByteArray name;
+
+    const int qualifierCount = static_cast<int>(random() % 3);
+    for (int i = 0; i < qualifierCount; ++i) {
+        QByteArray qualifier = Words[random() % WordCount];
+        qualifier[0] = static_cast<char>(qualifier.at(0) - 'a' + 'A');
+        name += qualifier + "::";
+    }
+
+    const int wordCount = 1 + static_cast<int>(random() % 3);
+    const bool isSnakeCase = random() % 2 == 0;
+    for (int i = 0; i < wordCount; ++i) {
+        QByteArray word = Words[random() % WordCount];
+        if (i > 0 && isSnakeCase)
+            name += '_';
+        else if (i > 0)
+            word[0] = static_cast<char>(word.at(0) - 'a' + 'A');
+
+        name += word;
+    }
+
+    return name;
+}
+} // namespace
+
+class SymbolIndexBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void typoCandidates_data();
+    void typoCandidates();
+
+private:
+    SymbolIndex *m_index = nullptr;
+};
+
+void SymbolIndexBenchmark::initTestCase()
+{
+    std::mt19937 random(42);
+
+    m_index = new SymbolIndex();
+    m_index->append("QWidget::setWindowTitle", "Method", "qwidget.html", "setWindowTitle");
+    m_index->append("Document.getElementById", "Method", "document.html", "getElementById");
+
+    for (int i = m_index->count(); i < SymbolCount; ++i)
+        m_index->append(randomName(random), "Method", "api.html", QByteArray::number(i));
+
+    m_index->squeeze();
+}
+
+void SymbolIndexBenchmark::cleanupTestCase()
+{
+    delete m_index;
+}
+
+void SymbolIndexBenchmark::typoCandidates_data()
+{
+    QTest::addColumn<QByteArray>("needle");
+    QTest::addColumn<int>("maxDistance");
+    QTest::addColumn<QByteArray>("expectedName");
+
+    // Distances as chosen by Docset for these lengths.
+    QTest::newRow("transposition") << QByteArray("setWindowTilte") << 2
+                                   << QByteArray("QWidget::setWindowTitle");
+    QTest::newRow("deletion") << QByteArray("getElemntById") << 2
+                              << QByteArray("Document.getElementById");
+    QTest::newRow("common words") << QByteArray("pust_back") << 2 << QByteArray();
+    QTest::newRow("short") << QByteArray("fnid") << 1 << QByteArray();
+}
+
+// Also checks that the time of the fastest run stays within the budget.
+void SymbolIndexBenchmark::typoCandidates()
+{
+    static const int MaxTypoHitCount = 50;
+
+    QFETCH(QByteArray, needle);
+    QFETCH(int, maxDistance);
+    QFETCH(QByteArray, expectedName);
+
+    QVector<SymbolIndex::TypoMatch> matches;
+    qint64 elapsed = std::numeric_limits<qint64>::max();
+
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+
+        matches = m_index->typoCandidates(needle, maxDistance, MaxTypoHitCount);
+
+        elapsed = qMin(elapsed, timer.elapsed());
+    }
+
+    QVERIFY2(elapsed <= MaxTypoSearchTime, qPrintable(QStringLiteral("%1 ms").arg(elapsed)));
+
+    if (!expectedName.isEmpty()) {
+        const auto isExpected = [this, &expectedName](const SymbolIndex::TypoMatch &match) {
+            return expectedName == m_index->name(match.index);
+        };
+
+        QVERIFY(std::any_of(matches.cbegin(), matches.cend(), isExpected));
+    }
+}
+
+QTEST_APPLESS_MAIN(SymbolIndexBenchmark)
+
+#include "symbolindexbenchmark.moc"
@@ -380,6 +380,8 @@ void DocsetsDialog::downloadCompleted()
             item->setData(ProgressItemDelegate::FormatRole, tr("Installing: %p%"));
         }
 
+        m_docsetRegistry->beginInstall(QDir(m_application->settings()->docsetPath)
+                                       .filePath(docsetDirectoryName));
         m_application->extract(tmpFile->fileName(), m_application->settings()->docsetPath,
                                docsetDirectoryName);
         break;
@@ -447,6 +449,7 @@ void DocsetsDialog::extractionCompleted(const QString &filePath)
     metadata.save(docsetPath, metadata.latestVersion());
 
     m_docsetRegistry->loadDocset(docsetPath);
+    m_docsetRegistry->endInstall(docsetPath);
 
     QListWidgetItem *listItem = findDocsetListItem(docsetName);
     if (listItem) {
@@ -465,6 +468,9 @@ void DocsetsDialog::extractionError(const QString &filePath, const QString &erro
     QMessageBox::warning(this, QStringLiteral("Zeal"),
                          tr("Cannot extract docset <b>%1</b>: %2").arg(docsetName, errorString));
 
+    const QDir dataDir(m_application->settings()->docsetPath);
+    m_docsetRegistry->endInstall(dataDir.filePath(docsetName + QLatin1String(".docset")));
+
     QListWidgetItem *listItem = findDocsetListItem(docsetName);
     if (listItem)
         listItem->setData(ProgressItemDelegate::ShowProgressRole, false);
@@ -215,12 +215,41 @@ SearchSidebar::SearchSidebar(const SearchSidebar *other, QWidget *parent)
     // Setup Docset Registry.
     auto registry = Core::Application::instance()->docsetRegistry();
     using Registry::DocsetRegistry;
-    connect(registry, &DocsetRegistry::searchCompleted,
-            this, [this](const QList<Registry::SearchResult> &results) {
+    connect(registry, &DocsetRegistry::searchStarted, this, [this]() {
         if (!isVisible())
             return;
 
-        m_searchModel->setResults(results);
+        m_searchModel->startStreaming();
+    });
+
+    connect(registry, &DocsetRegistry::searchResultsMerged,
+            this, [this](const QList<Registry::SearchResult> &results, const QVector<int> &rows,
+                         int rowCount) {
+        if (!isVisible())
+            return;
+
+        m_searchModel->mergeResults(results, rows, rowCount);
+    });
+
+    connect(registry, &DocsetRegistry::searchCompleted, this, [this](bool hasMoreResults) {
+        if (!isVisible())
+            return;
+
+        m_searchModel->finishStreaming(hasMoreResults);
+    });
+
+    // Pages are requested for the query of this tab, and apply even if it has been hidden since.
+    connect(registry, &DocsetRegistry::moreResultsFetched,
+            this, [this](const QString &query, int offset,
+                         const QList<Registry::SearchResult> &results, bool hasMoreResults) {
+        if (query != m_searchEdit->text() || offset != m_searchModel->rowCount())
+            return;
+
+        m_searchModel->appendResults(results, hasMoreResults);
+    });
+
+    connect(m_searchModel, &Registry::SearchModel::fetchMoreRequested, this, [this, registry]() {
+        registry->fetchMoreResults(m_searchEdit->text(), m_searchModel->rowCount());
     });
 
     connect(registry, &DocsetRegistry::docsetAboutToBeUnloaded, this, [this](const QString &name) {
@@ -181,6 +181,8 @@ void SettingsDialog::loadSettings()
 
     // Search Tab
     ui->fuzzySearchCheckBox->setChecked(settings->fuzzySearchEnabled);
+    ui->fuzzySearchBestMatchCheckBox->setChecked(settings->fuzzySearchBestMatchEnabled);
+    ui->docsetPreloadCheckBox->setChecked(settings->docsetPreloadEnabled);
 
     // Content Tab
     for (int i = 0; i < ui->defaultFontComboBox->count(); ++i) {
@@ -261,6 +263,8 @@ void SettingsDialog::saveSettings()
 
     // Search Tab
     settings->fuzzySearchEnabled = ui->fuzzySearchCheckBox->isChecked();
+    settings->fuzzySearchBestMatchEnabled = ui->fuzzySearchBestMatchCheckBox->isChecked();
+    settings->docsetPreloadEnabled = ui->docsetPreloadCheckBox->isChecked();
 
     // Content Tab
     settings->defaultFontFamily = ui->defaultFontComboBox->currentData().toString();
@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "sqliteconnectionpool.h"
+
+#include "sqlitedatabase.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+using namespace Zeal::Util;
+
+SQLiteConnectionPool::Connection::Connection(SQLiteConnectionPool *pool)
+    : m_pool(pool)
+    , m_db(pool->acquire())
+{
+}
+
+SQLiteConnectionPool::Connection::~Connection()
+{
+    if (m_db != nullptr)
+        m_pool->release(m_db);
+}
+
+SQLiteDatabase *SQLiteConnectionPool::Connection::operator->() const
+{
+    return m_db;
+}
+
+SQLiteDatabase *SQLiteConnectionPool::Connection::get() const
+{
+    return m_db;
+}
+
+SQLiteConnectionPool::SQLiteConnectionPool(const QString &path, int maxSize)
+    : m_path(path)
+{
+    m_statistics.maxSize = qMax(1, maxSize);
+}
+
+SQLiteConnectionPool::~SQLiteConnectionPool()
+{
+    // All connections must be released by now.
+    Q_ASSERT(m_idleConnections.size() == m_connections.size());
+    qDeleteAll(m_connections);
+}
+
+SQLiteDatabase *SQLiteConnectionPool::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+
+    ++m_statistics.acquireCount;
+
+    if (m_idleConnections.isEmpty() && m_connections.size() < m_statistics.maxSize) {
+        auto db = new SQLiteDatabase(m_path, SQLiteDatabase::OpenMode::ReadOnly);
+        if (!db->isOpen()) {
+            qWarning("SQL Error: %s", qPrintable(db->lastError()));
+            delete db;
+            return nullptr;
+        }
+
+        m_connections.append(db);
+        m_statistics.size = m_connections.size();
+        return db;
+    }
+
+    if (m_idleConnections.isEmpty()) {
+        ++m_statistics.waitCount;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        while (m_idleConnections.isEmpty())
+            m_released.wait(&m_mutex);
+
+        const qint64 waitTime = timer.nsecsElapsed() / 1000;
+        m_statistics.totalWaitTime += waitTime;
+        m_statistics.maxWaitTime = qMax(m_statistics.maxWaitTime, waitTime);
+    }
+
+    return m_idleConnections.takeLast();
+}
+
+void SQLiteConnectionPool::release(SQLiteDatabase *db)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Q_ASSERT(m_connections.contains(db));
+    m_idleConnections.append(db);
+    m_released.wakeOne();
+}
+
+SQLiteConnectionPool::Statistics SQLiteConnectionPool::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statistics;
+}
+
+int SQLiteConnectionPool::defaultMaxSize()
+{
+    return qBound(2, QThread::idealThreadCount(), 4);
+}
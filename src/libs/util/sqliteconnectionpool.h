@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef ZEAL_UTIL_SQLITECONNECTIONPOOL_H
+#define ZEAL_UTIL_SQLITECONNECTIONPOOL_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+
+namespace Zeal {
+namespace Util {
+
+class SQLiteDatabase;
+
+/**
+ * @short A pool of read-only connections to a single database.
+ *
+ * Each connection is used by one thread at a time, so concurrent readers do not
+ * serialize on a shared connection. Connections are opened on demand, and once
+ * the maximum size is reached, acquire() waits until one is released.
+ */
+class SQLiteConnectionPool
+{
+    Q_DISABLE_COPY(SQLiteConnectionPool)
+public:
+    struct Statistics
+    {
+        int size = 0; // Number of open connections.
+        int maxSize = 0;
+        int acquireCount = 0;
+        int waitCount = 0; // Number of times acquire() had to wait.
+        qint64 totalWaitTime = 0; // Microseconds.
+        qint64 maxWaitTime = 0; // Microseconds.
+    };
+
+    /// Scoped connection, which is released back to the pool on destruction.
+    class Connection
+    {
+        Q_DISABLE_COPY(Connection)
+    public:
+        explicit Connection(SQLiteConnectionPool *pool);
+        ~Connection();
+
+        SQLiteDatabase *operator->() const;
+        SQLiteDatabase *get() const;
+
+    private:
+        SQLiteConnectionPool *m_pool;
+        SQLiteDatabase *m_db;
+    };
+
+    explicit SQLiteConnectionPool(const QString &path, int maxSize = defaultMaxSize());
+    ~SQLiteConnectionPool();
+
+    /// Returns a connection, or nullptr if the database cannot be opened.
+    SQLiteDatabase *acquire();
+    void release(SQLiteDatabase *db);
+
+    Statistics statistics() const;
+
+    static int defaultMaxSize();
+
+private:
+    QString m_path;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_released;
+    QVector<SQLiteDatabase *> m_connections;
+    QVector<SQLiteDatabase *> m_idleConnections;
+    Statistics m_statistics;
+};
+
+} // namespace Util
+} // namespace Zeal
+
+#endif // ZEAL_UTIL_SQLITECONNECTIONPOOL_H
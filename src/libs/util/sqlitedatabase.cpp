@@ -22,16 +22,24 @@
 
 #include "sqlitedatabase.h"
 
+#include "sqlitestatement.h"
+
 #include <sqlite3.h>
 
+#include <utility>
+
 using namespace Zeal::Util;
 
-SQLiteDatabase::SQLiteDatabase(const QString &path)
+SQLiteDatabase::SQLiteDatabase(const QString &path, OpenMode mode)
 {
     if (sqlite3_initialize() != SQLITE_OK)
         return;
 
-    if (sqlite3_open16(path.constData(), &m_db) != SQLITE_OK) {
+    const int flags = mode == OpenMode::ReadOnly
+            ? SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX
+            : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    if (sqlite3_open_v2(path.toUtf8(), &m_db, flags, nullptr) != SQLITE_OK) {
         updateLastError();
         close();
     }
@@ -39,7 +47,7 @@ SQLiteDatabase::SQLiteDatabase(const QString &path)
 
 SQLiteDatabase::~SQLiteDatabase()
 {
-    finalize();
+    qDeleteAll(m_statementCache);
     close();
 }
 
@@ -50,111 +58,12 @@ bool SQLiteDatabase::isOpen() const
 
 QStringList SQLiteDatabase::tables()
 {
-    // FIXME: Do not use the shared statement.
-    Q_ASSERT(!m_stmt);
-
-    static const QString sql = QStringLiteral("SELECT name"
-                                              "  FROM"
-                                              "    (SELECT * FROM sqlite_master UNION ALL"
-                                              "    SELECT * FROM sqlite_temp_master)"
-                                              "  WHERE type='table'"
-                                              "  ORDER BY name");
-
-    if (m_db == nullptr || !prepare(sql)) {
-        return {};
-    }
-
-
-    QStringList list;
-    while (next()) {
-        list.append(value(0).toString());
-    }
-
-    return list;
+    return masterEntries(QStringLiteral("table"));
 }
 
 QStringList SQLiteDatabase::views()
 {
-    // FIXME: Do not use the shared statement.
-    Q_ASSERT(!m_stmt);
-
-    static const QString sql = QStringLiteral("SELECT name"
-                                              "  FROM"
-                                              "    (SELECT * FROM sqlite_master UNION ALL"
-                                              "    SELECT * FROM sqlite_temp_master)"
-                                              "  WHERE type='view'"
-                                              "  ORDER BY name");
-
-    if (m_db == nullptr || !prepare(sql)) {
-        return {};
-    }
-
-
-    QStringList list;
-    while (next()) {
-        list.append(value(0).toString());
-    }
-
-    return list;
-}
-
-bool SQLiteDatabase::prepare(const QString &sql)
-{
-    if (m_db == nullptr) {
-        return false;
-    }
-
-    if (m_stmt != nullptr) {
-        finalize();
-    }
-
-    m_lastError.clear();
-
-    sqlite3_mutex_enter(sqlite3_db_mutex(m_db));
-    const void *pzTail = nullptr;
-    const int res = sqlite3_prepare16_v2(m_db, sql.constData(), (sql.size() + 1) * 2,
-                                         &m_stmt, &pzTail); // 2 = sizeof(QChar)
-    sqlite3_mutex_leave(sqlite3_db_mutex(m_db));
-
-    if (res != SQLITE_OK) {
-        // "Unable to execute statement"
-        updateLastError();
-        finalize();
-        return false;
-    }
-
-    if (pzTail && !QString(static_cast<const QChar *>(pzTail)).trimmed().isEmpty()) {
-        // Unable to execute multiple statements at a time
-        updateLastError();
-        finalize();
-        return false;
-    }
-
-    return true;
-}
-
-bool SQLiteDatabase::next()
-{
-    if (m_stmt == nullptr)
-        return false;
-
-    sqlite3_mutex_enter(sqlite3_db_mutex(m_db));
-    const int res = sqlite3_step(m_stmt);
-    sqlite3_mutex_leave(sqlite3_db_mutex(m_db));
-
-    switch (res) {
-    case SQLITE_ROW:
-        return true;
-    case SQLITE_DONE:
-    case SQLITE_CONSTRAINT:
-    case SQLITE_ERROR:
-    case SQLITE_MISUSE:
-    case SQLITE_BUSY:
-    default:
-        updateLastError();
-    }
-
-    return false;
+    return masterEntries(QStringLiteral("view"));
 }
 
 bool SQLiteDatabase::execute(const QString &sql)
@@ -179,34 +88,35 @@ bool SQLiteDatabase::execute(const QString &sql)
     return true;
 }
 
-QVariant SQLiteDatabase::value(int index) const
+SQLiteStatement *SQLiteDatabase::cachedStatement(const QString &sql)
 {
-    Q_ASSERT(index >= 0);
+    SQLiteStatement *&stmt = m_statementCache[sql];
+    if (stmt == nullptr) {
+        stmt = new SQLiteStatement(this, sql);
+    } else {
+        stmt->reset();
+    }
 
-    // sqlite3_data_count() returns 0 if m_stmt is nullptr.
-    if (index >= sqlite3_data_count(m_stmt))
-        return QVariant();
+    return stmt;
+}
 
-    sqlite3_mutex_enter(sqlite3_db_mutex(m_db));
-    const int type = sqlite3_column_type(m_stmt, index);
-
-    QVariant ret;
-
-    switch (type) {
-    case SQLITE_INTEGER:
-        ret = sqlite3_column_int64(m_stmt, index);
-        break;
-    case SQLITE_NULL:
-        ret = QVariant(QVariant::String);
-        break;
-    default:
-        ret = QString(static_cast<const QChar *>(sqlite3_column_text16(m_stmt, index)),
-                      sqlite3_column_bytes16(m_stmt, index) / 2); // 2 = sizeof(QChar)
-        break;
+void SQLiteDatabase::setInterruptCallback(std::function<bool()> callback)
+{
+    // Number of virtual machine instructions between callback invocations.
+    static const int ProgressHandlerInterval = 1000;
+
+    if (m_db == nullptr) {
+        return;
     }
 
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_db));
+    m_interruptCallback = std::move(callback);
+    if (m_interruptCallback) {
+        sqlite3_progress_handler(m_db, ProgressHandlerInterval, &SQLiteDatabase::progressHandler, this);
+    } else {
+        sqlite3_progress_handler(m_db, 0, nullptr, nullptr);
+    }
     sqlite3_mutex_leave(sqlite3_db_mutex(m_db));
-    return ret;
 }
 
 QString SQLiteDatabase::lastError() const
@@ -220,12 +130,6 @@ void SQLiteDatabase::close()
     m_db = nullptr;
 }
 
-void SQLiteDatabase::finalize()
-{
-    sqlite3_finalize(m_stmt);
-    m_stmt = nullptr;
-}
-
 void SQLiteDatabase::updateLastError()
 {
     if (!m_db)
@@ -234,6 +138,35 @@ void SQLiteDatabase::updateLastError()
     m_lastError = QString(static_cast<const QChar *>(sqlite3_errmsg16(m_db)));
 }
 
+QStringList SQLiteDatabase::masterEntries(const QString &type)
+{
+    static const QString sql = QStringLiteral("SELECT name"
+                                              "  FROM"
+                                              "    (SELECT * FROM sqlite_master UNION ALL"
+                                              "    SELECT * FROM sqlite_temp_master)"
+                                              "  WHERE type = ?"
+                                              "  ORDER BY name");
+
+    SQLiteStatement stmt(this, sql);
+    if (!stmt.bind(1, type)) {
+        return {};
+    }
+
+    QStringList list;
+    while (stmt.next()) {
+        list.append(stmt.stringValue(0));
+    }
+
+    return list;
+}
+
+int SQLiteDatabase::progressHandler(void *data)
+{
+    // Non-zero return value interrupts the running statement.
+    auto db = static_cast<SQLiteDatabase *>(data);
+    return db->m_interruptCallback() ? 1 : 0;
+}
+
 sqlite3 *SQLiteDatabase::handle() const
 {
     return m_db;
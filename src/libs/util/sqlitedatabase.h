@@ -23,19 +23,27 @@
 #ifndef ZEAL_UTIL_SQLITEDATABASE_H
 #define ZEAL_UTIL_SQLITEDATABASE_H
 
+#include <QHash>
 #include <QStringList>
-#include <QVariant>
+
+#include <functional>
 
 struct sqlite3;
-struct sqlite3_stmt;
 
 namespace Zeal {
 namespace Util {
 
+class SQLiteStatement;
+
 class SQLiteDatabase
 {
 public:
-    explicit SQLiteDatabase(const QString &path);
+    enum class OpenMode {
+        ReadWrite,
+        ReadOnly ///< Connection is used by one thread at a time, so SQLite does not lock it.
+    };
+
+    explicit SQLiteDatabase(const QString &path, OpenMode mode = OpenMode::ReadWrite);
     virtual ~SQLiteDatabase();
 
     bool isOpen() const;
@@ -43,12 +51,16 @@ public:
     QStringList tables();
     QStringList views();
 
-    bool prepare(const QString &sql);
-    bool next();
-
     bool execute(const QString &sql);
 
-    QVariant value(int index) const;
+    /// Returns a statement owned by the database, which is prepared only once and
+    /// reset on each call. It must not be used after the database is destroyed.
+    SQLiteStatement *cachedStatement(const QString &sql);
+
+    /// Running statements are interrupted as soon as \a callback returns true, which
+    /// makes them fail with the SQLiteStatement::Status::Interrupted status. The callback
+    /// applies to all statements of this connection, pass nullptr to remove it.
+    void setInterruptCallback(std::function<bool()> callback);
 
     QString lastError() const;
 
@@ -56,11 +68,14 @@ public:
 
 private:
     void close();
-    void finalize();
     void updateLastError();
+    QStringList masterEntries(const QString &type);
+
+    static int progressHandler(void *data);
 
     sqlite3 *m_db = nullptr;
-    sqlite3_stmt *m_stmt = nullptr;
+    std::function<bool()> m_interruptCallback;
+    QHash<QString, SQLiteStatement *> m_statementCache;
     QString m_lastError;
 };
 
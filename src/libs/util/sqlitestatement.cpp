@@ -0,0 +1,180 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "sqlitestatement.h"
+
+#include "sqlitedatabase.h"
+
+#include <sqlite3.h>
+
+using namespace Zeal::Util;
+
+SQLiteStatement::SQLiteStatement(SQLiteDatabase *db, const QString &sql)
+    : m_db(db)
+{
+    if (!m_db->isOpen()) {
+        m_status = Status::Error;
+        m_lastError = QStringLiteral("Database is not open");
+        return;
+    }
+
+    const QByteArray sqlUtf8 = sql.toUtf8();
+
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_db->handle()));
+    const char *tail = nullptr;
+    const int res = sqlite3_prepare_v2(m_db->handle(), sqlUtf8.constData(), sqlUtf8.size() + 1,
+                                       &m_stmt, &tail);
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_db->handle()));
+
+    if (res != SQLITE_OK) {
+        checkResult(res);
+        sqlite3_finalize(m_stmt);
+        m_stmt = nullptr;
+        return;
+    }
+
+    if (tail && !QByteArray(tail).trimmed().isEmpty()) {
+        m_status = Status::Error;
+        m_lastError = QStringLiteral("Unable to execute multiple statements at a time");
+        sqlite3_finalize(m_stmt);
+        m_stmt = nullptr;
+    }
+}
+
+SQLiteStatement::~SQLiteStatement()
+{
+    sqlite3_finalize(m_stmt);
+}
+
+bool SQLiteStatement::isValid() const
+{
+    return m_stmt != nullptr;
+}
+
+bool SQLiteStatement::bind(int index, int value)
+{
+    return m_stmt != nullptr && checkResult(sqlite3_bind_int(m_stmt, index, value));
+}
+
+bool SQLiteStatement::bind(int index, qint64 value)
+{
+    return m_stmt != nullptr && checkResult(sqlite3_bind_int64(m_stmt, index, value));
+}
+
+bool SQLiteStatement::bind(int index, const QByteArray &value)
+{
+    return m_stmt != nullptr
+            && checkResult(sqlite3_bind_text(m_stmt, index, value.constData(), value.size(),
+                                             SQLITE_TRANSIENT));
+}
+
+bool SQLiteStatement::bind(int index, const QString &value)
+{
+    return m_stmt != nullptr
+            && checkResult(sqlite3_bind_text16(m_stmt, index, value.constData(),
+                                               value.size() * 2, // 2 = sizeof(QChar)
+                                               SQLITE_TRANSIENT));
+}
+
+bool SQLiteStatement::next()
+{
+    if (m_stmt == nullptr)
+        return false;
+
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_db->handle()));
+    const int res = sqlite3_step(m_stmt);
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_db->handle()));
+
+    switch (res) {
+    case SQLITE_ROW:
+        return true;
+    case SQLITE_DONE:
+        return false;
+    default:
+        checkResult(res);
+        return false;
+    }
+}
+
+bool SQLiteStatement::reset()
+{
+    if (m_stmt == nullptr)
+        return false;
+
+    m_status = Status::Ok;
+    m_lastError.clear();
+
+    // Errors from the last step are reported again by sqlite3_reset(), and are not relevant.
+    sqlite3_reset(m_stmt);
+    return checkResult(sqlite3_clear_bindings(m_stmt));
+}
+
+bool SQLiteStatement::isNull(int index) const
+{
+    return sqlite3_column_type(m_stmt, index) == SQLITE_NULL;
+}
+
+int SQLiteStatement::intValue(int index) const
+{
+    return sqlite3_column_int(m_stmt, index);
+}
+
+qint64 SQLiteStatement::int64Value(int index) const
+{
+    return sqlite3_column_int64(m_stmt, index);
+}
+
+QByteArray SQLiteStatement::rawValue(int index) const
+{
+    // sqlite3_column_bytes() must be called after sqlite3_column_text().
+    const char *text = reinterpret_cast<const char *>(sqlite3_column_text(m_stmt, index));
+    return QByteArray::fromRawData(text, sqlite3_column_bytes(m_stmt, index));
+}
+
+QString SQLiteStatement::stringValue(int index) const
+{
+    const char *text = reinterpret_cast<const char *>(sqlite3_column_text(m_stmt, index));
+    if (text == nullptr)
+        return QString();
+
+    return QString::fromUtf8(text, sqlite3_column_bytes(m_stmt, index));
+}
+
+SQLiteStatement::Status SQLiteStatement::status() const
+{
+    return m_status;
+}
+
+QString SQLiteStatement::lastError() const
+{
+    return m_lastError;
+}
+
+bool SQLiteStatement::checkResult(int result)
+{
+    if (result == SQLITE_OK)
+        return true;
+
+    m_status = result == SQLITE_INTERRUPT ? Status::Interrupted : Status::Error;
+    m_lastError = QString(static_cast<const QChar *>(sqlite3_errmsg16(m_db->handle())));
+    return false;
+}
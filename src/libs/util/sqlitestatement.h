@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Oleg Shparber
+** Contact: https://go.zealdocs.org/l/contact
+**
+** This file is part of Zeal.
+**
+** Zeal is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Zeal is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with Zeal. If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef ZEAL_UTIL_SQLITESTATEMENT_H
+#define ZEAL_UTIL_SQLITESTATEMENT_H
+
+#include <QByteArray>
+#include <QString>
+
+struct sqlite3_stmt;
+
+namespace Zeal {
+namespace Util {
+
+class SQLiteDatabase;
+
+/**
+ * @short A prepared SQLite statement.
+ *
+ * Any number of statements can be used with the same database. Parameters are
+ * bound with bind(), and the statement can be executed again after reset(),
+ * without parsing the SQL again.
+ *
+ * Text columns are read as UTF-8, so SQLite does not convert them. Values
+ * returned by rawValue() point into SQLite memory and are only valid until the
+ * next call to next() or reset(), copy them if they need to live longer.
+ */
+class SQLiteStatement
+{
+    Q_DISABLE_COPY(SQLiteStatement)
+public:
+    enum class Status {
+        Ok,
+        Interrupted, ///< Aborted by SQLiteDatabase::setInterruptCallback().
+        Error
+    };
+
+    explicit SQLiteStatement(SQLiteDatabase *db, const QString &sql);
+    ~SQLiteStatement();
+
+    bool isValid() const;
+
+    /// Binds a value to the parameter with 1-based \a index.
+    bool bind(int index, int value);
+    bool bind(int index, qint64 value);
+    bool bind(int index, const QByteArray &value);
+    bool bind(int index, const QString &value);
+
+    bool next();
+    bool reset();
+
+    bool isNull(int index) const;
+    int intValue(int index) const;
+    qint64 int64Value(int index) const;
+    QByteArray rawValue(int index) const;
+    QString stringValue(int index) const;
+
+    Status status() const;
+    QString lastError() const;
+
+private:
+    bool checkResult(int result);
+
+    SQLiteDatabase *m_db = nullptr;
+    sqlite3_stmt *m_stmt = nullptr;
+    Status m_status = Status::Ok;
+    QString m_lastError;
+};
+
+} // namespace Util
+} // namespace Zeal
+
+#endif // ZEAL_UTIL_SQLITESTATEMENT_H